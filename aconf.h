@@ -23,6 +23,11 @@
  */
 /* #undef OPI_SUPPORT */
 
+/*
+ * Enables multithreading support.
+ */
+#define MULTITHREADED 1
+
 /*
  * Use gzip instead of uncompress.
  */
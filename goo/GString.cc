@@ -14,6 +14,7 @@
 #pragma implementation
 #endif
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <stddef.h>
 #include <string.h>
@@ -679,6 +680,67 @@ void GString::formatDouble(double x, char *buf, int bufSize, int prec,
   *len = bufSize - i;
 }
 
+int GString::formatFixed(double x, char *buf, int bufSize, int prec) {
+  static const double pow10[10] = {
+    1, 10, 100, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9
+  };
+  char tmp[32];
+  double p, err, n, f;
+  unsigned long long u;
+  GBool neg;
+  int i, j, len;
+
+  // NaN, infinity, huge values and unusual precisions: these are rare
+  // enough to leave to the C library
+  if (prec < 0 || prec > 9 || !(fabs(x) < 4.0e15 / pow10[prec])) {
+    char big[400];		// enough for DBL_MAX with 9 digits
+    len = snprintf(big, sizeof(big), "%.*f", prec, x);
+    if (len < 0 || len > bufSize || len >= (int)sizeof(big)) {
+      return -1;
+    }
+    memcpy(buf, big, len);
+    return len;
+  }
+
+  // x * 10^prec = p + err exactly; round that to an integer, with
+  // halfway cases going to even, as printf does
+  neg = signbit(x) != 0;
+  if (neg) {
+    x = -x;
+  }
+  p = x * pow10[prec];
+  err = fma(x, pow10[prec], -p);
+  n = floor(p);
+  f = p - n;
+  if (f > 0.5 || (f == 0.5 && (err > 0 || (err == 0 && fmod(n, 2) != 0)))) {
+    n += 1;
+  }
+  u = (unsigned long long)n;
+
+  // digits, right to left
+  i = sizeof(tmp);
+  for (j = 0; j < prec; ++j) {
+    tmp[--i] = (char)('0' + (int)(u % 10));
+    u /= 10;
+  }
+  if (prec > 0) {
+    tmp[--i] = '.';
+  }
+  do {
+    tmp[--i] = (char)('0' + (int)(u % 10));
+    u /= 10;
+  } while (u);
+  if (neg) {
+    tmp[--i] = '-';
+  }
+  len = (int)sizeof(tmp) - i;
+  if (len > bufSize) {
+    return -1;
+  }
+  memcpy(buf, tmp + i, len);
+  return len;
+}
+
 GString *GString::insert(int i, char c) {
   int j;
 
@@ -73,6 +73,13 @@ public:
   static GString *format(const char *fmt, ...);
   static GString *formatv(const char *fmt, va_list argList);
 
+  // Format <x> in fixed point with <prec> (0..9) digits after the
+  // decimal point.  The result is the same as printf("%.<prec>f") in
+  // the C locale, including the rounding of halfway cases, but much
+  // faster.  At most <bufSize> chars are written to <buf> (no
+  // trailing NUL); returns the length, or -1 if <buf> is too small.
+  static int formatFixed(double x, char *buf, int bufSize, int prec);
+
   // Destructor.
   ~GString();
 
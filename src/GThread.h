@@ -0,0 +1,133 @@
+//========================================================================
+//
+// GThread.h
+//
+// Portable thread, thread-local key and condition macros, following
+// the wrapper code in xpdf/TileCache.cc.
+//
+// NB: This wrapper code is not meant to be general purpose.  Pthreads
+// condition objects are not equivalent to Windows event objects, in
+// general.
+//
+//========================================================================
+
+#ifndef GTHREAD_H
+#define GTHREAD_H
+
+#include <aconf.h>
+#include "GMutex.h"
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <pthread.h>
+#endif
+
+//-------------------- Windows --------------------
+#ifdef _WIN32
+
+typedef HANDLE GThreadID;
+typedef DWORD (WINAPI *GThreadFunc)(void *);
+#define GThreadReturn DWORD WINAPI
+
+static inline void gCreateThread(GThreadID *thr, GThreadFunc threadFunc,
+				 void *data) {
+  *thr = CreateThread(NULL, 0, threadFunc, data, 0, NULL);
+}
+
+static inline void gJoinThread(GThreadID thr) {
+  WaitForSingleObject(thr, INFINITE);
+  CloseHandle(thr);
+}
+
+typedef DWORD GThreadKey;
+
+static inline void gCreateThreadKey(GThreadKey *key) {
+  *key = TlsAlloc();
+}
+
+static inline void gSetThreadKey(GThreadKey *key, void *value) {
+  TlsSetValue(*key, value);
+}
+
+static inline void *gGetThreadKey(GThreadKey *key) {
+  return TlsGetValue(*key);
+}
+
+typedef HANDLE GCondition;
+
+static inline void gInitCondition(GCondition *c) {
+  *c = CreateEvent(NULL, TRUE, FALSE, NULL);
+}
+
+static inline void gDestroyCondition(GCondition *c) {
+  CloseHandle(*c);
+}
+
+static inline void gSignalCondition(GCondition *c) {
+  SetEvent(*c);
+}
+
+static inline void gClearCondition(GCondition *c) {
+  ResetEvent(*c);
+}
+
+static inline void gWaitCondition(GCondition *c, GMutex *m) {
+  LeaveCriticalSection(m);
+  WaitForSingleObject(*c, INFINITE);
+  EnterCriticalSection(m);
+}
+
+//-------------------- pthreads --------------------
+#else
+
+typedef pthread_t GThreadID;
+typedef void *(*GThreadFunc)(void *);
+#define GThreadReturn void*
+
+static inline void gCreateThread(GThreadID *thr, GThreadFunc threadFunc,
+				 void *data) {
+  pthread_create(thr, NULL, threadFunc, data);
+}
+
+static inline void gJoinThread(GThreadID thr) {
+  pthread_join(thr, NULL);
+}
+
+typedef pthread_key_t GThreadKey;
+
+static inline void gCreateThreadKey(GThreadKey *key) {
+  pthread_key_create(key, NULL);
+}
+
+static inline void gSetThreadKey(GThreadKey *key, void *value) {
+  pthread_setspecific(*key, value);
+}
+
+static inline void *gGetThreadKey(GThreadKey *key) {
+  return pthread_getspecific(*key);
+}
+
+typedef pthread_cond_t GCondition;
+
+static inline void gInitCondition(GCondition *c) {
+  pthread_cond_init(c, NULL);
+}
+
+static inline void gDestroyCondition(GCondition *c) {
+  pthread_cond_destroy(c);
+}
+
+static inline void gSignalCondition(GCondition *c) {
+  pthread_cond_broadcast(c);
+}
+
+static inline void gClearCondition(GCondition *c) {
+}
+
+static inline void gWaitCondition(GCondition *c, GMutex *m) {
+  pthread_cond_wait(c, m);
+}
+
+#endif
+
+#endif
@@ -0,0 +1,99 @@
+//========================================================================
+//
+// HtmlArena.cc
+//
+//========================================================================
+
+#include <aconf.h>
+#include "gmem.h"
+#include "HtmlArena.h"
+
+// size of a regular block
+#define arenaBlockSize (64 * 1024)
+
+// reset() keeps at most this much memory for the next page
+#define arenaMaxKeep (16 * 1024 * 1024)
+
+// allocation granularity (and alignment)
+#define arenaAlign 16
+
+//------------------------------------------------------------------------
+// HtmlArena
+//------------------------------------------------------------------------
+
+HtmlArena::HtmlArena() {
+  blocks = newBlock(arenaBlockSize);
+  blocks->next = NULL;
+  cur = (char *)(blocks + 1);
+  end = cur + arenaAlign + blocks->size;
+  used = 0;
+}
+
+HtmlArena::~HtmlArena() {
+  Block *b;
+
+  while ((b = blocks)) {
+    blocks = b->next;
+    gfree(b);
+  }
+}
+
+HtmlArena::Block *HtmlArena::newBlock(size_t size) {
+  Block *b;
+
+  // the extra arenaAlign bytes leave room to align the first object
+  b = (Block *)gmalloc((int)(sizeof(Block) + size + arenaAlign));
+  b->size = size;
+  return b;
+}
+
+void *HtmlArena::alloc(size_t n) {
+  Block *b;
+  char *p;
+
+  n = (n + arenaAlign - 1) & ~(size_t)(arenaAlign - 1);
+  p = (char *)(((size_t)cur + arenaAlign - 1) & ~(size_t)(arenaAlign - 1));
+  if (p + n > end) {
+    b = newBlock(n > arenaBlockSize / 4 ? n : arenaBlockSize);
+    p = (char *)(((size_t)(b + 1) + arenaAlign - 1)
+		 & ~(size_t)(arenaAlign - 1));
+    if (n > arenaBlockSize / 4) {
+      // a large object gets a block of its own, behind the current
+      // one, so the rest of the current block is not wasted
+      b->next = blocks->next;
+      blocks->next = b;
+      used += n;
+      return p;
+    }
+    b->next = blocks;
+    blocks = b;
+    end = (char *)(b + 1) + arenaAlign + b->size;
+  }
+  cur = p + n;
+  used += n;
+  return p;
+}
+
+void HtmlArena::reset() {
+  Block *b;
+  size_t size;
+
+  if (blocks->next) {
+    // replace the chain by a single block that fits the last page
+    size = used + used / 4;
+    if (size < arenaBlockSize) {
+      size = arenaBlockSize;
+    } else if (size > arenaMaxKeep) {
+      size = arenaMaxKeep;
+    }
+    while ((b = blocks)) {
+      blocks = b->next;
+      gfree(b);
+    }
+    blocks = newBlock(size);
+    blocks->next = NULL;
+  }
+  cur = (char *)(blocks + 1);
+  end = cur + arenaAlign + blocks->size;
+  used = 0;
+}
@@ -0,0 +1,52 @@
+//========================================================================
+//
+// HtmlArena.h
+//
+// Page-scoped memory pool.  Objects that live exactly as long as a
+// page (its strings and their character arrays) are carved out of a
+// few large blocks and released together when the page is cleared.
+//
+//========================================================================
+
+#ifndef HTMLARENA_H
+#define HTMLARENA_H
+
+#include <stddef.h>
+
+//------------------------------------------------------------------------
+// HtmlArena
+//------------------------------------------------------------------------
+
+class HtmlArena {
+public:
+
+  HtmlArena();
+  ~HtmlArena();
+
+  // Return <n> bytes, aligned for any scalar type.  The memory stays
+  // valid until the next reset().
+  void *alloc(size_t n);
+
+  // Release everything allocated so far.  The blocks are kept (merged
+  // into one, up to a limit) for the next page.
+  void reset();
+
+  // Bytes allocated since the last reset().
+  size_t getUsed() { return used; }
+
+private:
+
+  struct Block {
+    Block *next;
+    size_t size;		// usable bytes after the header
+  };
+
+  Block *newBlock(size_t size);
+
+  Block *blocks;		// current block first
+  char *cur;			// next free byte in blocks
+  char *end;			// end of blocks
+  size_t used;			// bytes handed out since the last reset
+};
+
+#endif
@@ -0,0 +1,86 @@
+//========================================================================
+//
+// HtmlBackground.cc
+//
+//========================================================================
+
+#include <aconf.h>
+#include <stdio.h>
+#include "GString.h"
+#include "gfile.h"
+#include "PDFDoc.h"
+#include "SplashTypes.h"
+#include "SplashBitmap.h"
+#include "SplashOutputDev.h"
+#include "Error.h"
+#include "HtmlPNG.h"
+#include "HtmlBackground.h"
+
+//------------------------------------------------------------------------
+// HtmlBackground
+//------------------------------------------------------------------------
+
+HtmlBackground::HtmlBackground(PDFDoc *docA, double dpiA, GBool grayA,
+			       int timeoutA) {
+  SplashColor paperColor;
+
+  doc = docA;
+  dpi = dpiA;
+  gray = grayA;
+  timeout = timeoutA;
+  paperColor[0] = paperColor[1] = paperColor[2] = 0xff;
+  splashOut = new SplashOutputDev(gray ? splashModeMono8 : splashModeRGB8,
+				  1, gFalse, paperColor);
+  // the text is in the HTML layer
+  splashOut->setSkipText(gTrue, gTrue);
+  splashOut->startDoc(doc->getXRef());
+}
+
+HtmlBackground::~HtmlBackground() {
+  delete splashOut;
+}
+
+GBool HtmlBackground::abortCheck(void *data) {
+  HtmlBackground *bg = (HtmlBackground *)data;
+
+  return bg->pageClock.elapsed() * 1000 > bg->timeout;
+}
+
+GBool HtmlBackground::renderPage(int pg, GString *fileName) {
+  SplashBitmap *bitmap;
+  HtmlPNGWriter *png;
+  Guchar *row;
+  FILE *f;
+  GBool ok;
+  int y;
+
+  // same box and flags as the text pass, so the sizes agree
+  if (timeout > 0) {
+    pageClock.start();
+    doc->displayPage(splashOut, pg, dpi, dpi, 0, gTrue, gTrue, gTrue,
+		     &abortCheck, this);
+  } else {
+    doc->displayPage(splashOut, pg, dpi, dpi, 0, gTrue, gTrue, gTrue);
+  }
+  bitmap = splashOut->getBitmap();
+  if (!(f = openFile(fileName->getCString(), "wb"))) {
+    error(errIO, -1, "Couldn't open image file '{0:t}'", fileName);
+    return gFalse;
+  }
+  png = new HtmlPNGWriter(f, bitmap->getWidth(), bitmap->getHeight(),
+			  gray ? 1 : 3);
+  row = bitmap->getDataPtr();
+  for (y = 0; y < bitmap->getHeight(); ++y) {
+    png->writeRow(row);
+    row += bitmap->getRowSize();
+  }
+  ok = png->finish();
+  delete png;
+  if (fclose(f) != 0) {
+    ok = gFalse;
+  }
+  if (!ok) {
+    error(errIO, -1, "Error writing image file '{0:t}'", fileName);
+  }
+  return ok;
+}
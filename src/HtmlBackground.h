@@ -0,0 +1,49 @@
+//========================================================================
+//
+// HtmlBackground.h
+//
+// Background images for the complex (-c) output: each page rendered
+// with Splash, without its text, and written as a PNG file.
+//
+//========================================================================
+
+#ifndef HTMLBACKGROUND_H
+#define HTMLBACKGROUND_H
+
+#include "gtypes.h"
+#include "HtmlStats.h"
+
+class GString;
+class PDFDoc;
+class SplashOutputDev;
+
+//------------------------------------------------------------------------
+// HtmlBackground
+//------------------------------------------------------------------------
+
+class HtmlBackground {
+public:
+
+  // Render pages of <docA> at <dpiA>, in gray if <grayA> is set.  A
+  // page that takes more than <timeoutA> ms (if above 0) is left
+  // partly drawn.
+  HtmlBackground(PDFDoc *docA, double dpiA, GBool grayA, int timeoutA = 0);
+  ~HtmlBackground();
+
+  // Render page <pg> and write it to <fileName>.  The image has the
+  // size of that page, as the text layer of the same page does.
+  GBool renderPage(int pg, GString *fileName);
+
+private:
+
+  static GBool abortCheck(void *data);
+
+  PDFDoc *doc;
+  double dpi;
+  GBool gray;
+  int timeout;			// ms per page, 0 = no limit
+  HtmlStopwatch pageClock;
+  SplashOutputDev *splashOut;
+};
+
+#endif
@@ -0,0 +1,143 @@
+/*========================================================================
+ *
+ * HtmlBinary.h
+ *
+ * Layout of the -binary output: the page data of the -xml output as
+ * columns of fixed-size values that can be used in place, e.g. from a
+ * memory-mapped file.  This header is plain C and depends only on
+ * <stdint.h>, so loaders can include it as is.
+ *
+ * The file starts with an HtmlBinFileHeader, followed by one record per
+ * page.  A record is an HtmlBinPage header and then the columns, each
+ * at the offset given in col[] (from the start of the record).  All
+ * numbers are little-endian; floating point values are IEEE doubles.
+ * Records, and the columns in them, start at multiples of 8 bytes
+ * from the start of the file.  The next record starts <size> bytes
+ * after the current one.
+ *
+ * Strings (text, font names, file names, link targets) are stored in
+ * the record's string table as NUL-terminated UTF-8 and referred to by
+ * their offset in it; htmlBinNoString means "none".
+ *
+ *========================================================================*/
+
+#ifndef HTMLBINARY_H
+#define HTMLBINARY_H
+
+#include <stdint.h>
+
+#define htmlBinMagic "PDF2BIN"		/* 8 bytes, with the NUL */
+#define htmlBinVersion 1
+#define htmlBinPageMagic 0x45474150u	/* "PAGE" */
+#define htmlBinNoString 0xffffffffu
+
+/* Columns of a page record.  The comment gives the element type and
+ * the number of elements, in terms of the counts in HtmlBinPage. */
+enum {
+  htmlBinStrings,		/* char[nStringBytes]: string table */
+
+  htmlBinFontId,		/* int32[nFonts]: id used by the texts */
+  htmlBinFontSize,		/* int32[nFonts]: size in pixels */
+  htmlBinFontColor,		/* uint32[nFonts]: 0xRRGGBB */
+  htmlBinFontFlags,		/* uint32[nFonts]: htmlBinFontItalic ... */
+  htmlBinFontFamily,		/* uint32[nFonts]: string */
+  htmlBinFontName,		/* uint32[nFonts]: string, full name */
+
+  htmlBinTextXMin,		/* double[nTexts]: bounding box */
+  htmlBinTextYMin,		/* double[nTexts] */
+  htmlBinTextXMax,		/* double[nTexts] */
+  htmlBinTextYMax,		/* double[nTexts] */
+  htmlBinTextFont,		/* int32[nTexts]: font id */
+  htmlBinTextString,		/* uint32[nTexts]: string */
+  htmlBinTextLength,		/* uint32[nTexts]: bytes in the string */
+
+  htmlBinPathSubpath,		/* uint32[nPaths + 1]: first subpath of
+				 * each path, then nSubpaths */
+  htmlBinPathStyle,		/* int32[nPaths]: style index */
+  htmlBinSubpathPoint,		/* uint32[nSubpaths + 1]: first point of
+				 * each subpath, then nPoints */
+  htmlBinPointX,		/* double[nPoints] */
+  htmlBinPointY,		/* double[nPoints] */
+
+  htmlBinStyleFill,		/* int32[3 * nStyles]: r, g, b */
+  htmlBinStyleStroke,		/* int32[3 * nStyles]: r, g, b */
+  htmlBinStyleLineWidth,	/* double[nStyles] */
+  htmlBinStyleDash,		/* uint32[nStyles]: first dash length */
+  htmlBinStyleNumDash,		/* uint32[nStyles]: number of lengths */
+  htmlBinStyleDashStart,	/* double[nStyles]: dash phase */
+  htmlBinDash,			/* double[nDashes]: dash lengths */
+
+  htmlBinImageX,		/* int32[nImages] */
+  htmlBinImageY,		/* int32[nImages] */
+  htmlBinImageWidth,		/* int32[nImages]: original size */
+  htmlBinImageHeight,		/* int32[nImages] */
+  htmlBinImageDrawnWidth,	/* double[nImages]: size on the page */
+  htmlBinImageDrawnHeight,	/* double[nImages] */
+  htmlBinImageRotation,		/* double[nImages]: degrees */
+  htmlBinImageFile,		/* uint32[nImages]: string */
+
+  htmlBinLinkX1,		/* double[nLinks] */
+  htmlBinLinkY1,		/* double[nLinks] */
+  htmlBinLinkX2,		/* double[nLinks] */
+  htmlBinLinkY2,		/* double[nLinks] */
+  htmlBinLinkDest,		/* uint32[nLinks]: string */
+
+  htmlBinNumColumns
+};
+
+/* htmlBinFontFlags bits */
+#define htmlBinFontItalic 1
+#define htmlBinFontBold 2
+#define htmlBinFontOblique 4
+
+/* HtmlBinPage.truncated: why the page was cut short */
+#define htmlBinNotTruncated 0
+#define htmlBinTruncatedTime 1		/* over -page-timeout */
+#define htmlBinTruncatedMemory 2	/* over -page-mem */
+
+typedef struct {
+  char magic[8];		/* htmlBinMagic */
+  uint32_t version;		/* htmlBinVersion */
+  uint32_t headerSize;		/* offset of the first page record */
+} HtmlBinFileHeader;
+
+typedef struct {
+  uint32_t magic;		/* htmlBinPageMagic */
+  uint32_t size;		/* bytes in the record, header included */
+  int32_t number;		/* page number */
+  int32_t width, height;	/* page size */
+  int32_t truncated;		/* htmlBinTruncated... */
+  double rotation;		/* page rotation, degrees */
+  uint32_t nStringBytes;
+  uint32_t nFonts;		/* fonts first used on this page */
+  uint32_t nTexts;
+  uint32_t nPaths;
+  uint32_t nSubpaths;
+  uint32_t nPoints;
+  uint32_t nStyles;
+  uint32_t nDashes;
+  uint32_t nImages;
+  uint32_t nLinks;
+  uint32_t col[htmlBinNumColumns + (htmlBinNumColumns & 1)];
+} HtmlBinPage;
+
+/* Address of column <c> of <page>. */
+static inline const void *htmlBinColumn(const HtmlBinPage *page, int c) {
+  return (const char *)page + page->col[c];
+}
+
+/* Address of string <off> of <page>, or 0 for htmlBinNoString. */
+static inline const char *htmlBinString(const HtmlBinPage *page,
+					uint32_t off) {
+  if (off == htmlBinNoString) {
+    return 0;
+  }
+  return (const char *)htmlBinColumn(page, htmlBinStrings) + off;
+}
+
+/* The record after <page>. */
+static inline const HtmlBinPage *htmlBinNextPage(const HtmlBinPage *page) {
+  return (const HtmlBinPage *)((const char *)page + page->size);
+}
+
+#endif
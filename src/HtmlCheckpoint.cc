@@ -0,0 +1,343 @@
+//========================================================================
+//
+// HtmlCheckpoint.cc
+//
+//========================================================================
+
+#include <aconf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "gmem.h"
+#include "GString.h"
+#include "GList.h"
+#include "GfxState.h"
+#include "Error.h"
+#include "HtmlFonts.h"
+#include "HtmlImageCache.h"
+#include "HtmlCheckpoint.h"
+
+#define ckptVersion 1
+
+// font flags
+#define ckptItalic 1
+#define ckptBold 2
+#define ckptOblique 4
+
+//------------------------------------------------------------------------
+// HtmlCheckpoint
+//------------------------------------------------------------------------
+
+HtmlCheckpoint::HtmlCheckpoint(unsigned long long hashA, double sizeA,
+			       const char *formatA, int firstPageA,
+			       int lastPageA) {
+  hash = hashA;
+  size = sizeA;
+  format = new GString(formatA);
+  firstPage = firstPageA;
+  lastPage = lastPageA;
+  fileName = NULL;
+  f = NULL;
+  fonts = new GList();
+  bgDone = (GBool *)gmallocn(lastPage >= firstPage ? lastPage - firstPage + 1
+						   : 1,
+			     sizeof(GBool));
+  reset();
+  gInitMutex(&mutex);
+}
+
+HtmlCheckpoint::~HtmlCheckpoint() {
+  if (f) {
+    fclose(f);
+  }
+  if (fileName) {
+    delete fileName;
+  }
+  delete format;
+  deleteGList(fonts, HtmlFont);
+  gfree(bgDone);
+  gDestroyMutex(&mutex);
+}
+
+// Forget what a checkpoint file said.
+void HtmlCheckpoint::reset() {
+  int i;
+
+  lastDone = 0;
+  imgNum = 1;
+  deleteGList(fonts, HtmlFont);
+  fonts = new GList();
+  for (i = 0; i <= lastPage - firstPage; ++i) {
+    bgDone[i] = gFalse;
+  }
+}
+
+GBool HtmlCheckpoint::hashFile(char *fileNameA, unsigned long long *hashA,
+			       double *sizeA) {
+  FILE *in;
+  char buf[65536];
+  int n;
+
+  if (!(in = fopen(fileNameA, "rb"))) {
+    return gFalse;
+  }
+  *hashA = HtmlImageCache::hashStart();
+  *sizeA = 0;
+  while ((n = (int)fread(buf, 1, sizeof(buf), in)) > 0) {
+    *hashA = HtmlImageCache::hashUpdate(*hashA, buf, n);
+    *sizeA += n;
+  }
+  fclose(in);
+  return gTrue;
+}
+
+GBool HtmlCheckpoint::resume(GString *outFileNameA) {
+  struct stat st;
+  long long offset;
+
+  if (fileName) {
+    delete fileName;
+  }
+  fileName = outFileNameA->copy()->append(".ckpt");
+  reset();
+
+  if (!readCheckpoint(fileName, &offset)) {
+    reset();
+    return gFalse;
+  }
+  // the output must still hold everything the checkpoint records
+  if (stat(outFileNameA->getCString(), &st) != 0 ||
+      (long long)st.st_size < offset ||
+      truncate(outFileNameA->getCString(), (off_t)offset) != 0 ||
+      !(f = fopen(fileName->getCString(), "a"))) {
+    reset();
+    return gFalse;
+  }
+  return gTrue;
+}
+
+// Read the checkpoint file <ckptFileName> and cut off anything after
+// its last complete page line.  Sets *<offset> to the length of the
+// output up to that page.
+GBool HtmlCheckpoint::readCheckpoint(GString *ckptFileName,
+				     long long *offset) {
+  FILE *in;
+  char line[4096], fmt[64], hex[3], *p;
+  GList *newFonts;
+  HtmlFont *font;
+  GString *name;
+  GfxRGB rgb;
+  unsigned long long hashA;
+  double sizeA, charSpace;
+  long long off, end, validEnd;
+  int version, first, n, pg, img, fontSize, lineSize, flags;
+  unsigned int color;
+  GBool header;
+
+  if (!(in = fopen(ckptFileName->getCString(), "r"))) {
+    return gFalse;
+  }
+  if (!fgets(line, sizeof(line), in) ||
+      sscanf(line, "pdftohtml-checkpoint %d %llx %lf %63s %d",
+	     &version, &hashA, &sizeA, fmt, &first) != 5 ||
+      version != ckptVersion || hashA != hash || sizeA != size ||
+      format->cmp(fmt) || first != firstPage) {
+    fclose(in);
+    return gFalse;
+  }
+
+  header = gFalse;
+  validEnd = 0;
+  newFonts = new GList();
+  while (fgets(line, sizeof(line), in)) {
+    n = (int)strlen(line);
+    if (n == 0 || line[n - 1] != '\n') {
+      break;			// cut short
+    }
+    line[--n] = '\0';
+    if (sscanf(line, "header %lld", &off) == 1) {
+      if (header) {
+	break;
+      }
+      header = gTrue;
+      *offset = off;
+      lastDone = firstPage - 1;
+    } else if (header && !strncmp(line, "font ", 5)) {
+      if (sscanf(line + 5, "%d %d %d %x %lf %n", &fontSize, &lineSize,
+		 &flags, &color, &charSpace, &n) != 5 ||
+	  line[5 + n] != '/') {
+	break;
+      }
+      name = new GString();
+      for (p = line + 5 + n + 1; *p; ++p) {
+	if (*p == '%' && p[1] && p[2]) {
+	  hex[0] = p[1];
+	  hex[1] = p[2];
+	  hex[2] = '\0';
+	  name->append((char)strtol(hex, NULL, 16));
+	  p += 2;
+	} else {
+	  name->append(*p);
+	}
+      }
+      rgb.r = byteToCol((color >> 16) & 0xff);
+      rgb.g = byteToCol((color >> 8) & 0xff);
+      rgb.b = byteToCol(color & 0xff);
+      font = new HtmlFont(name, fontSize + 1, charSpace, rgb);
+      font->isItalic((flags & ckptItalic) ? gTrue : gFalse);
+      font->isBold((flags & ckptBold) ? gTrue : gFalse);
+      font->isOblique((flags & ckptOblique) ? gTrue : gFalse);
+      font->setLineSize(lineSize);
+      newFonts->append(font);
+      delete name;
+    } else if (header &&
+	       sscanf(line, "page %d %lld %d", &pg, &off, &img) == 3) {
+      if (pg != lastDone + 1 || pg > lastPage) {
+	break;
+      }
+      lastDone = pg;
+      *offset = off;
+      imgNum = img;
+      fonts->append(newFonts);
+      delete newFonts;
+      newFonts = new GList();
+    } else if (header && sscanf(line, "background %d", &pg) == 1) {
+      if (pg < firstPage || pg > lastPage) {
+	break;
+      }
+      bgDone[pg - firstPage] = gTrue;
+    } else {
+      break;
+    }
+    end = ftell(in);
+    if (!newFonts->getLength()) {
+      validEnd = end;
+    }
+  }
+  deleteGList(newFonts, HtmlFont);
+  fclose(in);
+
+  // new lines go after the last complete page
+  return header &&
+         truncate(ckptFileName->getCString(), (off_t)validEnd) == 0;
+}
+
+int HtmlCheckpoint::getNumFonts() {
+  return fonts->getLength();
+}
+
+HtmlFont *HtmlCheckpoint::getFont(int i) {
+  return (HtmlFont *)fonts->get(i);
+}
+
+GBool HtmlCheckpoint::hasBackground(int pg) {
+  return pg >= firstPage && pg <= lastPage && bgDone[pg - firstPage];
+}
+
+void HtmlCheckpoint::headerDone(FILE *out) {
+  char buf[32];
+
+  if (!fileName) {
+    return;
+  }
+  if (f) {
+    fclose(f);
+  }
+  if (!(f = fopen(fileName->getCString(), "w"))) {
+    error(errIO, -1, "Couldn't open checkpoint file '{0:t}'", fileName);
+    return;
+  }
+  syncOutput(out);
+  snprintf(buf, sizeof(buf), "%016llx", hash);
+  fprintf(f, "pdftohtml-checkpoint %d %s %.0f %s %d\n",
+	  ckptVersion, buf, size, format->getCString(), firstPage);
+  fprintf(f, "header %lld\n", (long long)ftello(out));
+  sync();
+}
+
+void HtmlCheckpoint::pageDone(FILE *out, int pageNum, int imgNumA,
+			      HtmlFontAccu *fontsA, int firstFont) {
+  int i;
+
+  if (!f) {
+    return;
+  }
+  gLockMutex(&mutex);
+  // the page must reach the disk before the checkpoint says so
+  syncOutput(out);
+  for (i = firstFont; i < fontsA->size(); ++i) {
+    writeFont(fontsA->Get(i));
+  }
+  fprintf(f, "page %d %lld %d\n", pageNum, (long long)ftello(out), imgNumA);
+  sync();
+  gUnlockMutex(&mutex);
+}
+
+void HtmlCheckpoint::backgroundDone(int pageNum, GString *imgFileName) {
+  int fd;
+
+  if (!f) {
+    return;
+  }
+  // the image has been closed: reopen it to get it to the disk
+  if ((fd = open(imgFileName->getCString(), O_RDONLY)) >= 0) {
+    if (fsync(fd) != 0) {
+      error(errIO, -1, "Couldn't write image file '{0:t}'", imgFileName);
+    }
+    close(fd);
+  }
+  gLockMutex(&mutex);
+  fprintf(f, "background %d\n", pageNum);
+  sync();
+  gUnlockMutex(&mutex);
+}
+
+void HtmlCheckpoint::writeFont(HtmlFont *font) {
+  GString *name;
+  char *p;
+
+  fprintf(f, "font %u %d %d %06x %.17g /",
+	  font->getSize(), font->getLineSize(),
+	  (font->isItalic() ? ckptItalic : 0) |
+	  (font->isBold() ? ckptBold : 0) |
+	  (font->isOblique() ? ckptOblique : 0),
+	  font->getColor().getRGB(), font->getCharSpace());
+  name = font->getFullName();
+  for (p = name->getCString(); *p; ++p) {
+    if ((unsigned char)*p <= 0x20 || (unsigned char)*p >= 0x7f || *p == '%') {
+      fprintf(f, "%%%02x", *p & 0xff);
+    } else {
+      fputc(*p, f);
+    }
+  }
+  delete name;
+  fputc('\n', f);
+}
+
+// Get what has been written to the output file <out> to the disk,
+// before a checkpoint line that refers to it is written.
+void HtmlCheckpoint::syncOutput(FILE *out) {
+  if (fflush(out) != 0 || fsync(fileno(out)) != 0) {
+    error(errIO, -1, "Couldn't write output file");
+  }
+}
+
+void HtmlCheckpoint::sync() {
+  if (fflush(f) != 0 || fsync(fileno(f)) != 0) {
+    error(errIO, -1, "Couldn't write checkpoint file '{0:t}'", fileName);
+  }
+}
+
+void HtmlCheckpoint::finish() {
+  if (f) {
+    fclose(f);
+    f = NULL;
+  }
+  if (fileName) {
+    unlink(fileName->getCString());
+  }
+}
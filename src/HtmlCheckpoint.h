@@ -0,0 +1,113 @@
+//========================================================================
+//
+// HtmlCheckpoint.h
+//
+// -checkpoint: a record, next to the output file, of how far the
+// output has got, so a conversion that was killed can carry on where
+// it stopped instead of starting over.  The record (<output>.ckpt) is
+// a text file, appended to as each page is written:
+//
+//   pdftohtml-checkpoint 1 <input hash> <input size> <format> <first page>
+//   header <offset>
+//   font <size> <line size> <flags> <color> <char space> <name>
+//   page <number> <offset> <image number>
+//   background <number>
+//
+// Each page line says that the output, up to <offset>, holds the pages
+// up to <number>; the font lines before it are the fonts first used on
+// that page, which later pages refer to by number.  A background line
+// says that the -c background image of page <number> has been written;
+// those are rendered in a pass of their own (or by a pool of threads
+// alongside the pages), so they come in any order.  A line that was
+// cut short is ignored, and so are font lines without a page line.
+//
+//========================================================================
+
+#ifndef HTMLCHECKPOINT_H
+#define HTMLCHECKPOINT_H
+
+#include <stdio.h>
+#include "gtypes.h"
+#include "GMutex.h"
+
+class GString;
+class GList;
+class HtmlFont;
+class HtmlFontAccu;
+
+//------------------------------------------------------------------------
+// HtmlCheckpoint
+//------------------------------------------------------------------------
+
+class HtmlCheckpoint {
+public:
+
+  // Checkpoint of a conversion of an input with contents <hashA> and
+  // <sizeA> bytes to <formatA>, of pages <firstPageA> .. <lastPageA>.
+  HtmlCheckpoint(unsigned long long hashA, double sizeA, const char *formatA,
+		 int firstPageA, int lastPageA);
+  ~HtmlCheckpoint();
+
+  // Contents hash (see HtmlImageCache) and size of file <fileName>.
+  static GBool hashFile(char *fileName, unsigned long long *hash,
+			double *size);
+
+  // Look for the checkpoint of output file <outFileNameA>.  If there is
+  // one for this conversion, cut the output file back to the end of the
+  // last page it records and return true: the output is to be appended
+  // to, after the fonts and image number are restored.  Otherwise,
+  // return false: the output starts afresh.
+  GBool resume(GString *outFileNameA);
+
+  // After resume(): the last page in the output (0 if none), the
+  // fonts it declares, and the next image number.
+  int getLastPage() { return lastDone; }
+  int getNumFonts();
+  HtmlFont *getFont(int i);
+  int getImgNum() { return imgNum; }
+
+  // After resume(): true if the background image of page <pg> is there.
+  GBool hasBackground(int pg);
+
+  // Each of these gets the output and then the checkpoint to the disk
+  // (fsync), so a checkpoint line never outlives what it refers to.
+
+  // The document header has been written to <f>.
+  void headerDone(FILE *f);
+
+  // Page <pageNum> has been written to <f>.  The fonts <firstFont> ..
+  // of <fonts> were first used on it, and <imgNumA> is the next image
+  // number.
+  void pageDone(FILE *f, int pageNum, int imgNumA, HtmlFontAccu *fonts,
+		int firstFont);
+
+  // The background image of page <pageNum> has been written to
+  // <imgFileName> and closed.  Can be called from several threads at
+  // once.
+  void backgroundDone(int pageNum, GString *imgFileName);
+
+  // The output is complete: remove the checkpoint.
+  void finish();
+
+private:
+
+  GBool readCheckpoint(GString *ckptFileName, long long *offset);
+  void reset();
+  void writeFont(HtmlFont *font);
+  void syncOutput(FILE *out);
+  void sync();
+
+  unsigned long long hash;	// input
+  double size;
+  GString *format;		// output format
+  int firstPage, lastPage;	// page range
+  GString *fileName;		// checkpoint file
+  FILE *f;			//   and its stream (once written to)
+  int lastDone;			// last page in the output
+  int imgNum;			// next image number
+  GList *fonts;			// [HtmlFont] fonts of the output
+  GBool *bgDone;		// background written, by page - firstPage
+  GMutex mutex;			// for writing to f
+};
+
+#endif
@@ -0,0 +1,724 @@
+//========================================================================
+//
+// HtmlConverter.cc
+//
+//========================================================================
+
+#include <aconf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "GString.h"
+#include "gmem.h"
+#include "GMutex.h"
+#include "Object.h"
+#include "Stream.h"
+#include "Dict.h"
+#include "Catalog.h"
+#include "PDFDoc.h"
+#include "UnicodeMap.h"
+#include "PSOutputDev.h"
+#include "GlobalParams.h"
+#include "Error.h"
+#include "ErrorCodes.h"
+#include "config.h"
+#include "gfile.h"
+#include "HtmlOutputDev.h"
+#include "HtmlBackground.h"
+#include "HtmlWorkers.h"
+#include "HtmlImageCache.h"
+#include "HtmlStats.h"
+#include "HtmlCheckpoint.h"
+#include "HtmlErrors.h"
+#include "HtmlConverter.h"
+
+// messages for the xpdf error codes (ErrorCodes.h)
+static const char *errCodeNames[] = {
+  "no error",
+  "couldn't open the PDF file",
+  "couldn't read the page catalog",
+  "PDF file was damaged",
+  "file was encrypted and password was incorrect or not supplied",
+  "invalid highlight file",
+  "invalid printer",
+  "error during printing",
+  "PDF file doesn't allow that operation",
+  "invalid page number",
+  "file I/O error"
+};
+static const int nErrCodeNames = sizeof(errCodeNames) / sizeof(char *);
+
+static GString* getInfoString(Dict *infoDict, char *key);
+static GString* getInfoDate(Dict *infoDict, char *key);
+
+//------------------------------------------------------------------------
+// globalParams
+//------------------------------------------------------------------------
+
+// xpdf keeps its settings and caches in the globalParams object, which
+// is shared by all the converters of the process.  It is created by the
+// first converter and deleted by the last, unless the program had set
+// it up itself.
+static struct HtmlGlobalParamsRef {
+  HtmlGlobalParamsRef() { gInitMutex(&mutex); refCnt = 0; owned = gFalse; }
+  GMutex mutex;
+  int refCnt;			// converters using globalParams
+  GBool owned;			// created by a converter?
+} globalParamsRef;
+
+static void incGlobalParamsRef() {
+  gLockMutex(&globalParamsRef.mutex);
+  if (globalParamsRef.refCnt++ == 0 && !globalParams) {
+    globalParams = new GlobalParams("");
+    globalParamsRef.owned = gTrue;
+  }
+  gUnlockMutex(&globalParamsRef.mutex);
+}
+
+static void decGlobalParamsRef() {
+  gLockMutex(&globalParamsRef.mutex);
+  if (--globalParamsRef.refCnt == 0 && globalParamsRef.owned) {
+    delete globalParams;
+    globalParams = NULL;
+    globalParamsRef.owned = gFalse;
+  }
+  gUnlockMutex(&globalParamsRef.mutex);
+}
+
+//------------------------------------------------------------------------
+// HtmlOutputSink
+//------------------------------------------------------------------------
+
+// The stdio stream that convertData gives HtmlOutputDev in place of
+// the output file.  Whatever stdio hands over goes to the callback,
+// tagged with the page being written: the converter flushes the stream
+// after the header and after each page.
+struct HtmlOutputSink {
+  HtmlOutputFunc func;
+  void *data;
+  int pageNum;			// page of the bytes written next
+};
+
+#if defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || \
+    defined(__OpenBSD__) || defined(__DragonFly__)
+
+static int sinkWrite(void *cookie, const char *buf, int len) {
+  HtmlOutputSink *sink = (HtmlOutputSink *)cookie;
+
+  (*sink->func)(sink->data, sink->pageNum, buf, len);
+  return len;
+}
+
+static FILE *openSink(HtmlOutputSink *sink) {
+  return funopen(sink, NULL, &sinkWrite, NULL, NULL);
+}
+
+#else
+
+static ssize_t sinkWrite(void *cookie, const char *buf, size_t len) {
+  HtmlOutputSink *sink = (HtmlOutputSink *)cookie;
+
+  (*sink->func)(sink->data, sink->pageNum, buf, (int)len);
+  return len;
+}
+
+static FILE *openSink(HtmlOutputSink *sink) {
+  cookie_io_functions_t io;
+
+  io.read = NULL;
+  io.write = &sinkWrite;
+  io.seek = NULL;
+  io.close = NULL;
+  return fopencookie(sink, "w", io);
+}
+
+#endif
+
+//------------------------------------------------------------------------
+// HtmlConverter
+//------------------------------------------------------------------------
+
+HtmlConverter::HtmlConverter(HtmlParams *paramsA) {
+  params = *paramsA;
+  ok = gTrue;
+  sink = NULL;
+
+  // the strings may not outlive the caller's params
+  ownerPassword = params.ownerPassword ? new GString(params.ownerPassword)
+                                       : (GString *)NULL;
+  userPassword = params.userPassword ? new GString(params.userPassword)
+                                     : (GString *)NULL;
+  textEncName = params.textEncName ? new GString(params.textEncName)
+                                   : (GString *)NULL;
+  gsDevice = new GString(params.gsDevice ? params.gsDevice : "png16m");
+  params.ownerPassword = ownerPassword ? ownerPassword->getCString()
+                                       : (char *)NULL;
+  params.userPassword = userPassword ? userPassword->getCString()
+                                     : (char *)NULL;
+  params.textEncName = textEncName ? textEncName->getCString()
+                                   : (char *)NULL;
+  params.gsDevice = gsDevice->getCString();
+
+  incGlobalParamsRef();
+  incHtmlErrorRef();
+  HtmlErrorScope errScope(&params);
+
+  if (params.quiet) {
+    params.printCommands = gFalse; // I'm not 100% what is the differecne between them
+  }
+
+  if (textEncName) {
+    params.uMap = globalParams->getUnicodeMap(textEncName);
+  } else {
+    params.uMap = globalParams->getTextEncoding();
+  }
+  if (!params.uMap) {
+    ok = gFalse;
+  }
+
+   if (params.scale>3.0) params.scale=3.0;
+   if (params.scale<0.5) params.scale=0.5;
+   if (params.coordPrecision<0) params.coordPrecision=0;
+   if (params.coordPrecision>9) params.coordPrecision=9;
+
+   if (params.complexMode) {
+     //noframes=gFalse;
+     params.stout=gFalse;
+   }
+
+   if (params.stout) {
+     params.noframes=gTrue;
+     params.complexMode=gFalse;
+   }
+
+   if (params.stream) {
+     if (params.binary || params.jsonl) {
+       error(errCommandLine, -1, "-stream only works with the -xml output");
+       params.stream = gFalse;
+     } else {
+       // strings are written as they are ended, so they can't be
+       // combined, and pages are written as they are interpreted
+       params.xml = gTrue;
+       params.doCoalesce = gFalse;
+       params.nThreads = 1;
+     }
+   }
+
+   if (params.binary || params.jsonl)
+       params.xml = gTrue;
+
+   if (params.pathTolerance > 0 || params.maxPathPoints > 0)
+       params.outputPaths = gTrue;
+
+   if (params.xml)
+   {
+       params.complexMode = gTrue;
+       params.noframes = gTrue;
+       params.noMerge = gTrue;
+   }
+
+  // an image drawn again, or found again in a later document
+  // converted by this converter, is written only once
+  ownImageCache = gFalse;
+  if (params.outputImages && !params.imageCache) {
+    params.imageCache = new HtmlImageCache();
+    ownImageCache = gTrue;
+  }
+  params.outFile = NULL;
+  params.ckpt = NULL;
+  params.pageDone = NULL;
+  params.pageDoneData = NULL;
+}
+
+HtmlConverter::~HtmlConverter() {
+  if (ownImageCache) {
+    delete params.imageCache;
+  }
+  if (params.uMap) {
+    params.uMap->decRefCnt();
+  }
+  decHtmlErrorRef();
+  decGlobalParamsRef();
+  if (ownerPassword) {
+    delete ownerPassword;
+  }
+  if (userPassword) {
+    delete userPassword;
+  }
+  if (textEncName) {
+    delete textEncName;
+  }
+  delete gsDevice;
+}
+
+const char *HtmlConverter::getErrorString(int errCode) {
+  if (errCode < 0 || errCode >= nErrCodeNames) {
+    return "unknown error";
+  }
+  return errCodeNames[errCode];
+}
+
+int HtmlConverter::convertFile(char *pdfFileName, char *outFileName,
+			       int *nPages) {
+  HtmlErrorScope errScope(&params);
+  struct stat st;
+  PDFDoc *doc;
+  unsigned long long hash;
+  double size;
+  int errCode;
+
+  if (nPages) {
+    *nPages = 0;
+  }
+  hash = 0;
+  if (params.checkpoint) {
+    if (!HtmlCheckpoint::hashFile(pdfFileName, &hash, &size)) {
+      error(errIO, -1, "Couldn't open file '{0:s}'", pdfFileName);
+      return errOpenFile;
+    }
+  } else if (stat(pdfFileName, &st) == 0) {
+    size = (double)st.st_size;
+  } else {
+    size = -1;
+  }
+  doc = new PDFDoc(new GString(pdfFileName), ownerPassword, userPassword);
+  if (doc->isOk()) {
+    errCode = convert(doc, pdfFileName, outFileName, hash, size, nPages);
+  } else {
+    errCode = doc->getErrorCode();
+  }
+  delete doc;
+  return errCode;
+}
+
+int HtmlConverter::convertData(char *buf, Guint len, char *outFileName,
+			       HtmlOutputFunc outFunc, void *outData,
+			       int *nPages) {
+  PDFDoc *doc;
+  Object obj;
+  HtmlOutputSink sinkA;
+  HtmlErrorScope errScope(&params);
+  int errCode;
+
+  if (nPages) {
+    *nPages = 0;
+  }
+  if (!outFileName) {
+    outFileName = "pdftohtml";
+  }
+  if (outFunc) {
+    if (!params.noframes || params.stout) {
+      error(errCommandLine, -1,
+	    "Only the -noframes and -xml output can go to a callback");
+      return errFileIO;
+    }
+    sinkA.func = outFunc;
+    sinkA.data = outData;
+    sinkA.pageNum = 0;
+    if (!(params.outFile = openSink(&sinkA))) {
+      return errFileIO;
+    }
+    sink = &sinkA;
+    params.pageDone = &pageDone;
+    params.pageDoneData = this;
+  }
+
+  obj.initNull();
+  doc = new PDFDoc(new MemStream(buf, 0, len, &obj),
+		   ownerPassword, userPassword);
+  if (doc->isOk()) {
+    errCode = convert(doc, NULL, outFileName,
+		      HtmlImageCache::hashUpdate(HtmlImageCache::hashStart(),
+						 buf, len),
+		      (double)len, nPages);
+  } else {
+    errCode = doc->getErrorCode();
+  }
+  delete doc;
+
+  if (sink) {
+    sink->pageNum = 0;
+    fclose(params.outFile);
+    params.outFile = NULL;
+    params.pageDone = NULL;
+    params.pageDoneData = NULL;
+    sink = NULL;
+  }
+  return errCode;
+}
+
+void HtmlConverter::pageDone(void *data, int pageNum) {
+  HtmlConverter *conv = (HtmlConverter *)data;
+
+  // pages are written in order, and nothing is written between them
+  conv->sink->pageNum = pageNum;
+  fflush(conv->params.outFile);
+  conv->sink->pageNum = pageNum + 1;
+}
+
+// Convert the open document <doc>, read from file <pdfFileName> (NULL
+// if it was read from memory) of <size> bytes (-1 if unknown).
+// <outFileName> may be NULL if <pdfFileName> is not, in which case the
+// output name is derived from <pdfFileName>.  <hash> and <size>
+// identify the input for -checkpoint.
+int HtmlConverter::convert(PDFDoc *doc, char *pdfFileName, char *outFileName,
+			   unsigned long long hash, double size,
+			   int *nPages) {
+  GString *fileName = NULL;
+  GString *docTitle = NULL;
+  GString *author = NULL, *keywords = NULL, *subject = NULL, *date = NULL;
+  GString *htmlFileName = NULL;
+  GString *psFileName = NULL;
+  HtmlOutputDev *htmlOut = NULL;
+  PSOutputDev *psOut = NULL;
+  char *p;
+  char extension[16] = "png";
+  Object info;
+  char * extsList[] = {"png", "jpeg", "bmp", "pcx", "tiff", "pbm", NULL};
+  int firstPage, lastPage, firstTextPage;
+  GBool rawOrder;
+  GBool pngBackgrounds, grayBackgrounds;
+  HtmlBackgroundWorkers *bgWorkers;
+  HtmlCheckpoint *ckpt;
+  int errCode;
+
+  if (params.imageCache) {
+    params.imageCache->startDoc();
+  }
+  if (params.stats) {
+    params.stats->startDoc(pdfFileName ? pdfFileName : outFileName);
+  }
+
+  // check for copy permission
+  if (!doc->okToCopy() && !params.forceCopy) {
+    error(errNotAllowed, 0, "Copying of text from this document is not allowed.");
+    return errPermission;
+  }
+
+  // construct text file name
+  if (outFileName) {
+    GString* tmp = new GString(outFileName);
+    p = tmp->getCString() ;
+    int len = tmp->getLength();
+    if (!params.xml) {
+      if(len > 5)
+        p = p + len - 5;
+      if (len > 5 && (!strcmp(p, ".html") || !strcmp(p, ".HTML")))
+	htmlFileName = new GString(tmp->getCString(),
+				   tmp->getLength() - 5);
+      else htmlFileName =new GString(tmp);
+    } else if (params.jsonl) {
+      if (len > 6 && !strcmp(p + len - 6, ".jsonl"))
+	htmlFileName = new GString(tmp->getCString(), len - 6);
+      else htmlFileName = new GString(tmp);
+    } else {
+      if(len > 4)
+        p = p + len - 4;
+      if (len > 4 && (params.binary ? !strcmp(p, ".bin")
+		      : (!strcmp(p, ".xml") || !strcmp(p, ".XML"))))
+	htmlFileName = new GString(tmp->getCString(),
+				   tmp->getLength() - 4);
+      else htmlFileName =new GString(tmp);
+    }
+
+    delete tmp;
+  } else {
+    fileName = new GString(pdfFileName);
+    p = fileName->getCString() + fileName->getLength() - 4;
+    if (!strcmp(p, ".pdf") || !strcmp(p, ".PDF"))
+      htmlFileName = new GString(fileName->getCString(),
+				 fileName->getLength() - 4);
+    else
+      htmlFileName = fileName->copy();
+    //   htmlFileName->append(".html");
+  }
+
+  // get page range
+  firstPage = params.firstPage;
+  lastPage = params.lastPage;
+  if (firstPage < 1)
+    firstPage = 1;
+  if (lastPage < 1 || lastPage > doc->getNumPages())
+    lastPage = doc->getNumPages();
+
+  doc->getDocInfo(&info);
+  if (info.isDict()) {
+      docTitle = getInfoString(info.getDict(), "Title");
+      author = getInfoString(info.getDict(), "Author");
+      keywords = getInfoString(info.getDict(), "Keywords");
+      subject = getInfoString(info.getDict(), "Subject");
+      date = getInfoDate(info.getDict(), "ModDate");
+      if( !date )
+          date = getInfoDate(info.getDict(), "CreationDate");
+  }
+  if( !docTitle ) docTitle = new GString(htmlFileName);
+
+  /* determine extensions of output background images */
+  {int i;
+  for(i = 0; extsList[i]; i++)
+  {
+	  if( strstr(params.gsDevice, extsList[i]) != (char *) NULL )
+	  {
+		  strncpy(extension, extsList[i], sizeof(extension));
+		  break;
+	  }
+  }}
+
+  rawOrder = params.complexMode; // todo: figure out what exactly rawOrder do :)
+
+  // only a single output file, written from the start, can be resumed
+  ckpt = NULL;
+  if (params.checkpoint && params.noframes && !params.stout && !sink) {
+    ckpt = new HtmlCheckpoint(hash, size,
+			      !params.xml ? (!params.complexMode ? "html"
+					     : params.ignore ? "html-c-i"
+					     : "html-c")
+			      : params.binary ? "binary"
+			      : params.jsonl ? "jsonl"
+			      : params.stream ? "xml-stream" : "xml",
+			      firstPage, lastPage);
+    params.ckpt = ckpt;
+  }
+
+  // write text file
+  htmlOut = new HtmlOutputDev(&params, pdfFileName, size,
+	  htmlFileName->getCString(),
+	  docTitle->getCString(),
+	  author ? author->getCString() : NULL,
+	  keywords ? keywords->getCString() : NULL,
+          subject ? subject->getCString() : NULL,
+	  date ? date->getCString() : NULL,
+	  extension,
+	  rawOrder,
+	  firstPage,
+          doc->getCatalog()->getOutline()->isDict(), info.isDict() ? info.getDict() : NULL);
+
+  info.free();
+  delete docTitle;
+  if( author )
+  {
+      delete author;
+  }
+  if( keywords )
+  {
+      delete keywords;
+  }
+  if( subject )
+  {
+      delete subject;
+  }
+  if( date )
+  {
+      delete date;
+  }
+
+  if (sink) {
+    // the header is not part of any page
+    fflush(params.outFile);
+    sink->pageNum = firstPage;
+  }
+  // the pages already in the output are skipped; their numbers (e.g.,
+  // of the background images) still count from <firstPage>
+  firstTextPage = firstPage;
+  if (ckpt && ckpt->getLastPage() >= firstPage) {
+    firstTextPage = ckpt->getLastPage() + 1;
+  }
+
+  // PNG backgrounds are rendered in-process; with -j, a pool renders
+  // them while the text is being converted
+  pngBackgrounds = params.complexMode && !params.xml && !params.ignore &&
+                   !strcmp(extension, "png");
+  grayBackgrounds = strstr(params.gsDevice, "gray") ||
+                    strstr(params.gsDevice, "mono");
+  bgWorkers = NULL;
+  if (pngBackgrounds && params.nThreads > 1) {
+    bgWorkers = new HtmlBackgroundWorkers(doc, htmlFileName,
+					  static_cast<int>(72*params.scale),
+					  grayBackgrounds, params.pageTimeout,
+					  ckpt, params.nThreads);
+    bgWorkers->start(firstPage, lastPage);
+  }
+
+  if (htmlOut->isOk())
+  {
+	errCode = errNone;
+//	doc->displayPages(htmlOut, firstPage, lastPage, static_cast<int>(72*scale), static_cast<int>(72*scale), 0, gTrue, gTrue);
+	if (params.nThreads > 1) {
+	  htmlOut->displayPagesParallel(doc, firstTextPage, lastPage, static_cast<int>(72*params.scale), static_cast<int>(72*params.scale), params.nThreads);
+	} else {
+	  doc->displayPages(htmlOut, firstTextPage, lastPage, static_cast<int>(72*params.scale), static_cast<int>(72*params.scale), 0, gTrue, gTrue,gTrue,
+			    (params.pageTimeout > 0 || params.pageMem > 0)
+			      ? &HtmlOutputDev::abortCheck : NULL,
+			    htmlOut);
+	}
+	if (!params.xml)
+	{
+		htmlOut->dumpDocOutline(doc->getCatalog());
+	}
+	if (nPages) {
+	  *nPages = lastPage >= firstTextPage ? lastPage - firstTextPage + 1 : 0;
+	}
+  }
+  else
+  {
+	errCode = errFileIO;
+  }
+  if (sink) {
+    sink->pageNum = 0;
+  }
+
+  if (bgWorkers) {
+    bgWorkers->finish();
+    delete bgWorkers;
+  } else if (pngBackgrounds) {
+    // each image has its own page's size
+    HtmlBackground *bg;
+    GString *imgFileName;
+    int pg;
+
+    bg = new HtmlBackground(doc, static_cast<int>(72*params.scale),
+			    grayBackgrounds, params.pageTimeout);
+    for (pg = firstPage; pg <= lastPage; ++pg) {
+      if (ckpt && ckpt->hasBackground(pg)) {
+	continue;
+      }
+      imgFileName = GString::format("{0:t}{1:03d}.png", htmlFileName,
+				    pg - firstPage + 1);
+      if (bg->renderPage(pg, imgFileName) && ckpt) {
+	ckpt->backgroundDone(pg, imgFileName);
+      }
+      delete imgFileName;
+    }
+    delete bg;
+  } else if( params.complexMode && !params.xml && !params.ignore ) {
+    // other image formats still go through PostScript and Ghostscript
+    int h=xoutRound(htmlOut->getPageHeight()/params.scale);
+    int w=xoutRound(htmlOut->getPageWidth()/params.scale);
+    //int h=xoutRound(doc->getPageHeight(1)/scale);
+    //int w=xoutRound(doc->getPageWidth(1)/scale);
+
+    psFileName = new GString(htmlFileName->getCString());
+    psFileName->append(".ps");
+
+    globalParams->setPSPaperWidth(w);
+    globalParams->setPSPaperHeight(h);
+#if OLD_VERSION
+    globalParams->setPSNoText(gTrue);
+#endif
+
+    psOut = new PSOutputDev(psFileName->getCString(),
+#if OLD_VERSION
+                            doc->getXRef(),
+			    doc->getCatalog(),
+#else
+                            doc,
+#endif
+                            firstPage, lastPage, psModePS);
+   // doc->displayPages(psOut, firstPage, lastPage, static_cast<int>(72*scale), static_cast<int>(72*scale), 0, gTrue, gTrue);
+	doc->displayPages(psOut, firstPage, lastPage, static_cast<int>(72*params.scale), static_cast<int>(72*params.scale), 0, gTrue, gTrue,gTrue,NULL);
+    delete psOut;
+
+    /*sprintf(buf, "%s -sDEVICE=png16m -dBATCH -dNOPROMPT -dNOPAUSE -r72 -sOutputFile=%s%%03d.png -g%dx%d -q %s", GHOSTSCRIPT, htmlFileName->getCString(), w, h,
+      psFileName->getCString());*/
+
+    GString *gsCmd = new GString(GHOSTSCRIPT);
+    GString *tw, *th, *sc;
+    gsCmd->append(" -sDEVICE=");
+	gsCmd->append(params.gsDevice);
+	gsCmd->append(" -dBATCH -dNOPROMPT -dNOPAUSE -r");
+    sc = GString::fromInt(static_cast<int>(72*params.scale));
+    gsCmd->append(sc);
+    gsCmd->append(" -sOutputFile=");
+    gsCmd->append("\"");
+    gsCmd->append(htmlFileName);
+    gsCmd->append("%03d.");
+	gsCmd->append(extension);
+	gsCmd->append("\" -g");
+    tw = GString::fromInt(static_cast<int>(params.scale*w));
+    gsCmd->append(tw);
+    gsCmd->append("x");
+    th = GString::fromInt(static_cast<int>(params.scale*h));
+    gsCmd->append(th);
+    gsCmd->append(" -q \"");
+    gsCmd->append(psFileName);
+    gsCmd->append("\"");
+//    printf("running: %s\n", gsCmd->getCString());
+    if( !executeCommand(gsCmd->getCString()) && !params.quiet) {
+       error(errCommandLine, 0, "Failed to launch Ghostscript!\n");
+    }
+    unlink(psFileName->getCString());
+    delete tw;
+    delete th;
+    delete sc;
+    delete gsCmd;
+    delete psFileName;
+  }
+
+  delete htmlOut;
+
+  if (ckpt) {
+    if (errCode == errNone) {
+      ckpt->finish();
+    }
+    delete ckpt;
+    params.ckpt = NULL;
+  }
+
+  delete fileName;
+  delete htmlFileName;
+
+  return errCode;
+}
+
+static GString* getInfoString(Dict *infoDict, char *key) {
+  Object obj;
+  GString *s1 = NULL;
+
+  if (infoDict->lookup(key, &obj)->isString()) {
+    s1 = new GString(obj.getString());
+  }
+  obj.free();
+  return s1;
+}
+
+static GString* getInfoDate(Dict *infoDict, char *key) {
+  Object obj;
+  char *s;
+  int year, mon, day, hour, min, sec;
+  struct tm tmStruct;
+  GString *result = NULL;
+  char buf[256];
+
+  if (infoDict->lookup(key, &obj)->isString()) {
+    s = obj.getString()->getCString();
+    if (s[0] == 'D' && s[1] == ':') {
+      s += 2;
+    }
+    if (sscanf(s, "%4d%2d%2d%2d%2d%2d",
+               &year, &mon, &day, &hour, &min, &sec) == 6) {
+      tmStruct.tm_year = year - 1900;
+      tmStruct.tm_mon = mon - 1;
+      tmStruct.tm_mday = day;
+      tmStruct.tm_hour = hour;
+      tmStruct.tm_min = min;
+      tmStruct.tm_sec = sec;
+      tmStruct.tm_wday = -1;
+      tmStruct.tm_yday = -1;
+      tmStruct.tm_isdst = -1;
+      mktime(&tmStruct); // compute the tm_wday and tm_yday fields
+      if (strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S+00:00", &tmStruct)) {
+	result = new GString(buf);
+      } else {
+        result = new GString(s);
+      }
+    } else {
+      result = new GString(s);
+    }
+  }
+  obj.free();
+  return result;
+}
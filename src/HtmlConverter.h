@@ -0,0 +1,90 @@
+//========================================================================
+//
+// HtmlConverter.h
+//
+// The conversion of a document, as pdftohtml's main() used to do it,
+// for programs that link with libpdftohtml.a.  A converter holds the
+// settings (HtmlParams) and everything else that outlives a document,
+// so several converters can be used in one process.  The document can
+// be read from a file or from memory; the output goes to files, as
+// with the command line tool, or to a callback.
+//
+//========================================================================
+
+#ifndef HTMLCONVERTER_H
+#define HTMLCONVERTER_H
+
+#include <stdio.h>
+#include "gtypes.h"
+#include "HtmlParams.h"
+
+class GString;
+class PDFDoc;
+struct HtmlOutputSink;
+
+//------------------------------------------------------------------------
+
+// Receives the output of HtmlConverter::convertData(): <len> bytes of
+// page <pageNum>, or of the document header or trailer (<pageNum> =
+// 0).  The pieces, in the order they arrive, make up the output file.
+typedef void (*HtmlOutputFunc)(void *data, int pageNum,
+			       const char *buf, int len);
+
+//------------------------------------------------------------------------
+// HtmlConverter
+//------------------------------------------------------------------------
+
+class HtmlConverter {
+public:
+
+  // Convert with a copy of <paramsA>, completed the way the command
+  // line options are (-stream implies -xml, -xml implies -c, etc.).
+  // The strings are copied too.  The first converter of the process
+  // creates globalParams, the last one deletes it.  The -q and error
+  // function of <paramsA> only apply to this converter's messages
+  // (HtmlErrors.h).
+  HtmlConverter(HtmlParams *paramsA);
+  ~HtmlConverter();
+
+  // False if the text encoding is unknown.
+  GBool isOk() { return ok; }
+
+  HtmlParams *getParams() { return &params; }
+
+  // Convert <pdfFileName>.  The output file names are made from
+  // <outFileName>, or from <pdfFileName> if that is NULL.  Returns an
+  // xpdf error code (errNone on success) and sets *<nPages> (if not
+  // NULL) to the number of pages written.
+  int convertFile(char *pdfFileName, char *outFileName, int *nPages);
+
+  // Convert the PDF file in <buf>, which is not copied and must stay
+  // as it is until this returns.  With an <outFunc>, the output that
+  // would go to <outFileName> is passed to it; this only works for
+  // the single file formats (-noframes, -xml, -jsonl, -binary).
+  // Other files (images, -c pages) are still written, with names made
+  // from <outFileName> (NULL = "pdftohtml").  The -xml header has no
+  // <filename>, and <len> as the <filesize>.  Returns as convertFile.
+  int convertData(char *buf, Guint len, char *outFileName,
+		  HtmlOutputFunc outFunc, void *outData, int *nPages);
+
+  // Message for an error code returned by convertFile or convertData.
+  static const char *getErrorString(int errCode);
+
+private:
+
+  int convert(PDFDoc *doc, char *pdfFileName, char *outFileName,
+	      unsigned long long hash, double size, int *nPages);
+  static void pageDone(void *data, int pageNum);
+
+  HtmlParams params;
+  GString *ownerPassword;	// copies of the strings in params
+  GString *userPassword;
+  GString *textEncName;
+  GString *gsDevice;
+  GBool ownImageCache;		// params.imageCache made here?
+  HtmlOutputSink *sink;		// output callback of convertData (or
+				//   NULL)
+  GBool ok;
+};
+
+#endif
@@ -0,0 +1,95 @@
+//========================================================================
+//
+// HtmlErrors.cc
+//
+//========================================================================
+
+#include <aconf.h>
+#include <stdio.h>
+#include "gtypes.h"
+#include "GlobalParams.h"
+#include "Error.h"
+#include "GThread.h"
+#include "HtmlParams.h"
+#include "HtmlErrors.h"
+
+static struct HtmlErrorRef {
+  HtmlErrorRef() { gInitMutex(&mutex); refCnt = 0; keyOk = gFalse; }
+  GMutex mutex;
+  int refCnt;			// converters
+  GBool keyOk;			// key has been created?
+  GThreadKey key;		// [HtmlParams *] each thread's conversion
+  void (*prevCbk)(void *data, ErrorCategory category,	// the callback
+		  int pos, char *msg);			//   before the
+  void *prevCbkData;					//   first converter
+} errorRef;
+
+static void errorCbk(void *data, ErrorCategory category, int pos,
+		     char *msg) {
+  HtmlParams *params;
+
+  params = (HtmlParams *)gGetThreadKey(&errorRef.key);
+  if (params) {
+    if (params->errorFunc) {
+      (*params->errorFunc)(params->errorData, category, pos, msg);
+      return;
+    }
+    if (params->quiet) {
+      return;
+    }
+  } else if (errorRef.prevCbk) {
+    (*errorRef.prevCbk)(errorRef.prevCbkData, category, pos, msg);
+    return;
+  }
+
+  // as xpdf does without a callback
+  if (globalParams && globalParams->getErrQuiet()) {
+    return;
+  }
+  fflush(stdout);
+  if (pos >= 0) {
+    fprintf(stderr, "%s (%d): %s\n", errorCategoryNames[category], pos, msg);
+  } else {
+    fprintf(stderr, "%s: %s\n", errorCategoryNames[category], msg);
+  }
+  fflush(stderr);
+}
+
+void incHtmlErrorRef() {
+  gLockMutex(&errorRef.mutex);
+  if (!errorRef.keyOk) {
+    gCreateThreadKey(&errorRef.key);
+    errorRef.keyOk = gTrue;
+  }
+  if (errorRef.refCnt++ == 0) {
+    errorRef.prevCbk = getErrorCallback();
+    errorRef.prevCbkData = getErrorCallbackData();
+    setErrorCallback(&errorCbk, NULL);
+  }
+  gUnlockMutex(&errorRef.mutex);
+}
+
+void decHtmlErrorRef() {
+  gLockMutex(&errorRef.mutex);
+  if (--errorRef.refCnt == 0) {
+    setErrorCallback(errorRef.prevCbk, errorRef.prevCbkData);
+  }
+  gUnlockMutex(&errorRef.mutex);
+}
+
+HtmlParams *getHtmlErrorParams() {
+  return (HtmlParams *)gGetThreadKey(&errorRef.key);
+}
+
+//------------------------------------------------------------------------
+// HtmlErrorScope
+//------------------------------------------------------------------------
+
+HtmlErrorScope::HtmlErrorScope(HtmlParams *params) {
+  prev = getHtmlErrorParams();
+  gSetThreadKey(&errorRef.key, params);
+}
+
+HtmlErrorScope::~HtmlErrorScope() {
+  gSetThreadKey(&errorRef.key, prev);
+}
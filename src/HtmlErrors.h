@@ -0,0 +1,45 @@
+//========================================================================
+//
+// HtmlErrors.h
+//
+// xpdf has a single error callback for the whole process, but each
+// converter has its own -q and error function (HtmlParams).  While
+// any converter exists, the callback is one that looks up the
+// conversion the calling thread is working for, and passes the
+// message to its error function, drops it (-q), or prints it.
+// Messages from other threads go wherever they went before.
+//
+//========================================================================
+
+#ifndef HTMLERRORS_H
+#define HTMLERRORS_H
+
+class HtmlParams;
+
+// Install the callback when the first converter is created, and put
+// back the previous one when the last is deleted.
+extern void incHtmlErrorRef();
+extern void decHtmlErrorRef();
+
+// The conversion whose settings the calling thread's messages follow
+// (or NULL).
+extern HtmlParams *getHtmlErrorParams();
+
+//------------------------------------------------------------------------
+// HtmlErrorScope
+//------------------------------------------------------------------------
+
+// Messages from the calling thread follow <params> for as long as
+// this object lives.
+class HtmlErrorScope {
+public:
+
+  HtmlErrorScope(HtmlParams *params);
+  ~HtmlErrorScope();
+
+private:
+
+  HtmlParams *prev;		// the thread's previous conversion
+};
+
+#endif
@@ -1,3 +1,4 @@
+#include "gmem.h"
 #include "HtmlFonts.h"
 #include "GlobalParams.h"
 #include "UnicodeMap.h"
@@ -32,9 +33,9 @@ static Fonts fonts[font_num+1]={
 };
 
 #define xoutRound(x) ((int)(x + 0.5))
-extern GBool xml;
 
-GString* HtmlFont::DefaultFont=new GString("Times"); // Arial,Helvetica,sans-serif
+// used when a font has no name, or not one of the names above
+static const char *defaultFontName = "Times"; // Arial,Helvetica,sans-serif
 
 HtmlFontColor::HtmlFontColor(GfxRGB rgb){
  /*
@@ -114,8 +115,6 @@ HtmlFont::HtmlFont(GString* ftname,int _size, double _charspace, GfxRGB rgb){
     pos=i;
     delete fontname;
   }  
-  if (!DefaultFont) DefaultFont=new GString(fonts[font_num].name);
-
 }
  
 HtmlFont::HtmlFont(const HtmlFont& x){
@@ -150,13 +149,6 @@ HtmlFont& HtmlFont::operator=(const HtmlFont& x){
    return *this;
 }
 
-void HtmlFont::clear(){
-  if(DefaultFont) delete DefaultFont;
-  DefaultFont = NULL;
-}
-
-
-
 /*
   This function is used to compare font uniquely for insertion into
   the list of all encountered fonts
@@ -174,6 +166,22 @@ GBool HtmlFont::isEqual(const HtmlFont& x) const{
          );
 }
 
+unsigned int HtmlFont::hash() const{
+  unsigned int h = 2166136261u;
+  char *p;
+
+  if (FontName) {
+    for (p = FontName->getCString(); *p; ++p) {
+      h = (h ^ (unsigned char)*p) * 16777619u;
+    }
+  }
+  h = (h ^ size) * 16777619u;
+  h = (h ^ (unsigned int)pos) * 16777619u;
+  h = (h ^ ((bold ? 1 : 0) | (italic ? 2 : 0) | (oblique ? 4 : 0))) * 16777619u;
+  h = (h ^ color.hash()) * 16777619u;
+  return h;
+}
+
 /*
   This one is used to decide whether two pieces of text can be joined together
   and therefore we don't care about bold/italics properties
@@ -185,35 +193,27 @@ GBool HtmlFont::isEqualIgnoreBold(const HtmlFont& x) const{
 
 GString* HtmlFont::getFontName(){
    if (pos!=font_num) return new GString(fonts[pos].name);
-    else return new GString(DefaultFont);
+    else return new GString(defaultFontName);
 }
 
 GString* HtmlFont::getFullName(){
   if (FontName)
     return new GString(FontName);
-  else return new GString(DefaultFont);
+  else return new GString(defaultFontName);
 } 
 
-void HtmlFont::setDefaultFont(GString* defaultFont){
-  if (DefaultFont) delete DefaultFont;
-  DefaultFont=new GString(defaultFont);
-}
-
-
 GString* HtmlFont::getDefaultFont(){
-  return DefaultFont;
+  return new GString(defaultFontName);
 }
 
 // this method if plain wrong todo
-GString* HtmlFont::HtmlFilter(Unicode* u, int uLen) {
-  GString *tmp = new GString();
-  UnicodeMap *uMap;
+void HtmlFont::HtmlFilter(GString *tmp, Unicode* u, int uLen,
+			  UnicodeMap *uMap) {
   char buf[8];
   int n;
 
-  // get the output encoding
-  if (!(uMap = globalParams->getTextEncoding())) {
-    return tmp;
+  if (!uMap) {
+    return;
   }
 
   for (int i = 0; i < uLen; ++i) {
@@ -232,13 +232,19 @@ GString* HtmlFont::HtmlFilter(Unicode* u, int uLen) {
       }
     }
   }
+}
 
-  uMap->decRefCnt();
-  return tmp;
+GString* HtmlFont::simple(HtmlFont* font, Unicode* content, int uLen,
+			  UnicodeMap *uMap){
+  GString *cont = new GString();
+
+  simple(cont, font, content, uLen, uMap);
+  return cont;
 }
 
-GString* HtmlFont::simple(HtmlFont* font, Unicode* content, int uLen){
-  GString *cont=HtmlFilter (content, uLen); 
+void HtmlFont::simple(GString *cont, HtmlFont* font, Unicode* content,
+		      int uLen, UnicodeMap *uMap){
+  HtmlFilter(cont, content, uLen, uMap);
 
   /*if (font.isBold()) {
     cont->insert(0,"<b>",3);
@@ -248,28 +254,52 @@ GString* HtmlFont::simple(HtmlFont* font, Unicode* content, int uLen){
     cont->insert(0,"<i>",3);
     cont->append("</i>",4);x.oblique
     } */
-
-  return cont;
 }
 
-HtmlFontAccu::HtmlFontAccu(){
+HtmlFontAccu::HtmlFontAccu(GBool xmlA){
   accu=new GVector<HtmlFont>();
+  xml=xmlA;
+  hashTab=NULL;
+  hashSize=0;
+  rehash(64);
 }
 
 HtmlFontAccu::~HtmlFontAccu(){
   if (accu) delete accu;
+  gfree(hashTab);
 }
 
+void HtmlFontAccu::rehash(int newSize){
+  int i, h;
+
+  gfree(hashTab);
+  hashSize=newSize;
+  hashTab=(int *)gmallocn(hashSize,sizeof(int));
+  for (i=0;i<hashSize;i++) hashTab[i]=-1;
+  for (i=0;i<accu->size();i++) {
+    h=(int)(Get(i)->hash() & (hashSize-1));
+    while (hashTab[h]>=0) h=(h+1) & (hashSize-1);
+    hashTab[h]=i;
+  }
+}
+
+// Fonts keep the index they were first added at, which is what the
+// font ids in the output refer to.
 int HtmlFontAccu::AddFont(const HtmlFont& font){
- GVector<HtmlFont>::iterator i; 
- for (i=accu->begin();i!=accu->end();i++)
+ int h;
+
+ h=(int)(font.hash() & (hashSize-1));
+ while (hashTab[h]>=0)
  {
-	if (font.isEqual(*i)) 
+	if (font.isEqual(*Get(hashTab[h]))) 
 	{
-		return (int)(i-(accu->begin()));
+		return hashTab[h];
 	}
+	h=(h+1) & (hashSize-1);
  }
  accu->push_back(font);
+ hashTab[h]=accu->size()-1;
+ if (2*accu->size() > hashSize) rehash(2*hashSize);
  return (accu->size()-1);
 }
 
@@ -306,8 +336,9 @@ GString* HtmlFontAccu::CSStyle(int i){
    GString *fontName=font.getFontName();
    GString *lSize;
    double _charspace = font.getCharSpace();
-   char *cspace = new char [20];
-   sprintf(cspace,"%0.05f",_charspace);
+   char cspace[32];
+   int n = GString::formatFixed(_charspace, cspace, sizeof(cspace) - 1, 5);
+   cspace[n < 0 ? 0 : n] = '\0';
    if(!xml){
      tmp->append(".ft");
      tmp->append(iStr);
@@ -372,7 +403,6 @@ GString* HtmlFontAccu::CSStyle(int i){
    delete colorStr;
    delete iStr;
    delete Size;
-   delete cspace;
    return tmp;
 }
  
@@ -5,6 +5,7 @@
 #include "GfxState.h"
 #include "CharTypes.h"
 
+class UnicodeMap;
 
 GString *insertEntities(char *str);
 
@@ -28,6 +29,8 @@ class HtmlFontColor{
    GBool isEqual(const HtmlFontColor& col) const{
      return ((r==col.r)&&(g==col.g)&&(b==col.b));
    }
+   unsigned int hash() const {return (r<<16)^(g<<8)^b;}
+   unsigned int getRGB() const {return (r<<16)|(g<<8)|b;}
 } ;  
 
 
@@ -40,10 +43,9 @@ class HtmlFont{
    GBool bold;
    GBool oblique;
    int pos; // position of the font name in the fonts array
-   static GString *DefaultFont;
    GString *FontName;
    HtmlFontColor color;
-   static GString* HtmlFilter(Unicode* u, int uLen); //char* s);
+   static void HtmlFilter(GString *s, Unicode* u, int uLen, UnicodeMap *uMap);
 public:  
 
    HtmlFont(){FontName=NULL;};
@@ -52,7 +54,6 @@ public:
    HtmlFont& operator=(const HtmlFont& x);
    HtmlFontColor getColor() const {return color;}
    ~HtmlFont();
-   static void clear();
    GString* getFullName();
    GBool isItalic() const {return italic;}
    GBool isItalic(GBool val) {italic = val; return italic;}
@@ -66,20 +67,34 @@ public:
    GString* getFontName();
    double getCharSpace() const {return charspace;}
    void setCharSpace(double _charspace){charspace = _charspace;}
+   // name for fonts without one; the caller deletes it
    static GString* getDefaultFont();
-   static void setDefaultFont(GString* defaultFont);
    GBool isEqual(const HtmlFont& x) const;
+   // hash over the fields compared by isEqual
+   unsigned int hash() const;
    GBool isEqualIgnoreBold(const HtmlFont& x) const;
-   static GString* simple(HtmlFont *font, Unicode *content, int uLen);
+   // <content> as text in the output encoding <uMap>, with the XML
+   // special characters as entities
+   static GString* simple(HtmlFont *font, Unicode *content, int uLen,
+			  UnicodeMap *uMap);
+   // the same, appended to <s>
+   static void simple(GString *s, HtmlFont *font, Unicode *content,
+		      int uLen, UnicodeMap *uMap);
    void print() const {printf("font: %s %d %s%spos: %d\n", FontName->getCString(), size, bold ? "bold " : "", italic ? "italic " : "", pos);};
 };
 
 class HtmlFontAccu{
 private:
   GVector<HtmlFont> *accu;
+  GBool xml;			// emit <fontspec> instead of CSS
+  // open-addressed hash table of indices into accu (-1 = empty), so
+  // AddFont does not have to compare against every font seen so far
+  int *hashTab;
+  int hashSize;			// power of two, at least 2 * accu->size()
+  void rehash(int newSize);
   
 public:
-  HtmlFontAccu();
+  HtmlFontAccu(GBool xmlA);
   ~HtmlFontAccu();
   int AddFont(const HtmlFont& font);
   HtmlFont* Get(int i){
@@ -0,0 +1,98 @@
+//========================================================================
+//
+// HtmlImageCache.cc
+//
+//========================================================================
+
+#include <aconf.h>
+#include "GString.h"
+#include "GHash.h"
+#include "HtmlImageCache.h"
+
+//------------------------------------------------------------------------
+// HtmlImageCache
+//------------------------------------------------------------------------
+
+HtmlImageCache::HtmlImageCache() {
+  refs = new GHash(gTrue);
+  hashes = new GHash(gTrue);
+  gInitMutex(&mutex);
+}
+
+HtmlImageCache::~HtmlImageCache() {
+  deleteGHash(refs, GString);
+  deleteGHash(hashes, GString);
+  gDestroyMutex(&mutex);
+}
+
+void HtmlImageCache::startDoc() {
+  gLockMutex(&mutex);
+  deleteGHash(refs, GString);
+  refs = new GHash(gTrue);
+  gUnlockMutex(&mutex);
+}
+
+GString *HtmlImageCache::lookupRef(Ref ref) {
+  return lookup(refs, refKey(ref));
+}
+
+void HtmlImageCache::addRef(Ref ref, GString *fileName) {
+  add(refs, refKey(ref), fileName);
+}
+
+GString *HtmlImageCache::lookupData(unsigned long long hash, size_t len,
+				    const char *ext) {
+  return lookup(hashes, dataKey(hash, len, ext));
+}
+
+void HtmlImageCache::addData(unsigned long long hash, size_t len,
+			     const char *ext, GString *fileName) {
+  add(hashes, dataKey(hash, len, ext), fileName);
+}
+
+unsigned long long HtmlImageCache::hashUpdate(unsigned long long hash,
+					      const char *data, int n) {
+  int i;
+
+  for (i = 0; i < n; ++i) {
+    hash = (hash ^ (unsigned char)data[i]) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+GString *HtmlImageCache::refKey(Ref ref) {
+  return GString::format("{0:d} {1:d}", ref.num, ref.gen);
+}
+
+// The length and extension are part of the key, so a collision would
+// also need files of the same size and type.
+GString *HtmlImageCache::dataKey(unsigned long long hash, size_t len,
+				 const char *ext) {
+  return GString::format("{0:08ux}{1:08ux} {2:ud} {3:s}",
+			 (Guint)(hash >> 32), (Guint)hash, (Guint)len, ext);
+}
+
+GString *HtmlImageCache::lookup(GHash *h, GString *key) {
+  GString *fileName;
+
+  gLockMutex(&mutex);
+  if ((fileName = (GString *)h->lookup(key))) {
+    fileName = fileName->copy();
+  }
+  gUnlockMutex(&mutex);
+  delete key;
+  return fileName;
+}
+
+void HtmlImageCache::add(GHash *h, GString *key, GString *fileName) {
+  GString *old;
+
+  gLockMutex(&mutex);
+  if ((old = (GString *)h->lookup(key))) {
+    // found again under another key; keep the first name
+    delete key;
+  } else {
+    h->add(key, fileName->copy());
+  }
+  gUnlockMutex(&mutex);
+}
@@ -0,0 +1,67 @@
+//========================================================================
+//
+// HtmlImageCache.h
+//
+// Files written for -images, so an image that is drawn again is not
+// written again: by object number within a document, and by a hash of
+// the image file's contents across the documents of a batch.  All
+// methods can be called from several worker devices at once, but only
+// the main device adds files, in page order (see
+// HtmlOutputDev::nameImages).
+//
+//========================================================================
+
+#ifndef HTMLIMAGECACHE_H
+#define HTMLIMAGECACHE_H
+
+#include <stddef.h>
+#include "gtypes.h"
+#include "GMutex.h"
+#include "Object.h"
+
+class GString;
+class GHash;
+
+//------------------------------------------------------------------------
+// HtmlImageCache
+//------------------------------------------------------------------------
+
+class HtmlImageCache {
+public:
+
+  HtmlImageCache();
+  ~HtmlImageCache();
+
+  // Start a new document: forget the object numbers, keep the hashes.
+  void startDoc();
+
+  // Return (a copy of) the file written for image XObject <ref> of the
+  // current document, or NULL.
+  GString *lookupRef(Ref ref);
+  void addRef(Ref ref, GString *fileName);
+
+  // Contents hash (64-bit FNV-1a), computed block by block:
+  // hash = hashUpdate(hashStart(), block1, n1); ...
+  static unsigned long long hashStart() { return 0xcbf29ce484222325ULL; }
+  static unsigned long long hashUpdate(unsigned long long hash,
+				       const char *data, int n);
+
+  // Return (a copy of) a file with contents <hash> and <len> bytes, or
+  // NULL.  <ext> (the file name extension) is part of the key.
+  GString *lookupData(unsigned long long hash, size_t len, const char *ext);
+  void addData(unsigned long long hash, size_t len, const char *ext,
+	       GString *fileName);
+
+private:
+
+  GString *refKey(Ref ref);
+  GString *dataKey(unsigned long long hash, size_t len, const char *ext);
+  GString *lookup(GHash *h, GString *key);
+  void add(GHash *h, GString *key, GString *fileName);
+
+  GHash *refs;			// "num gen" -> GString file name
+  GHash *hashes;		// "hash len ext" -> GString file name
+  GMutex mutex;
+};
+
+#endif
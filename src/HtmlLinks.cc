@@ -1,3 +1,4 @@
+#include "gmem.h"
 #include "HtmlLinks.h"
 
 HtmlLink::HtmlLink(const HtmlLink& x){
@@ -88,23 +89,111 @@ GString* HtmlLink::getLinkStart() {
 
    
 
+// below this many links a linear scan is as fast as the index
+#define minIndexedLinks 16
+
+// upper limit on the number of bands
+#define maxLinkBands 1024
+
 HtmlLinks::HtmlLinks(){
   accu=new GVector<HtmlLink>();
+  indexOk=gFalse;
+  nBands=0;
+  bandY0=bandY1=bandH=0;
+  bandStart=NULL;
+  bandLinks=NULL;
 }
 
 HtmlLinks::~HtmlLinks(){
   delete accu;
   accu=NULL; 
+  gfree(bandStart);
+  gfree(bandLinks);
+}
+
+int HtmlLinks::getBand(double y) const {
+  int b=(int)((y-bandY0)/bandH);
+  if (b<0) return 0;
+  if (b>=nBands) return nBands-1;
+  return b;
+}
+
+void HtmlLinks::buildIndex() const {
+  GVector<HtmlLink>::iterator i;
+  int n=accu->size();
+  int b, b0, b1, total;
+  int *fill;
+
+  gfree(bandStart);
+  gfree(bandLinks);
+  bandStart=NULL;
+  bandLinks=NULL;
+  indexOk=gTrue;
+  if (n<minIndexedLinks) {
+    nBands=0;
+    return;
+  }
+
+  bandY0=accu->begin()->getY1();
+  bandY1=accu->begin()->getY2();
+  for(i=accu->begin();i!=accu->end();i++){
+    if (i->getY1()<bandY0) bandY0=i->getY1();
+    if (i->getY2()>bandY1) bandY1=i->getY2();
+  }
+  nBands=n<maxLinkBands ? n : maxLinkBands;
+  bandH=(bandY1-bandY0)/nBands;
+  if (!(bandH>0)) {
+    nBands=1;
+    bandH=1;
+  }
+
+  // count, then fill, the per-band lists; links are visited in order
+  // so every list is ascending
+  bandStart=(int *)gmallocn(nBands+1,sizeof(int));
+  memset(bandStart,0,(nBands+1)*sizeof(int));
+  for(i=accu->begin();i!=accu->end();i++){
+    b1=getBand(i->getY2());
+    for(b=getBand(i->getY1());b<=b1;b++) bandStart[b+1]++;
+  }
+  for(b=0;b<nBands;b++) bandStart[b+1]+=bandStart[b];
+  total=bandStart[nBands];
+  bandLinks=(int *)gmallocn(total>0 ? total : 1,sizeof(int));
+  fill=(int *)gmallocn(nBands,sizeof(int));
+  memcpy(fill,bandStart,nBands*sizeof(int));
+  for(i=accu->begin();i!=accu->end();i++){
+    b0=getBand(i->getY1());
+    b1=getBand(i->getY2());
+    for(b=b0;b<=b1;b++) bandLinks[fill[b]++]=(int)(i-accu->begin());
+  }
+  gfree(fill);
 }
 
 GBool HtmlLinks::inLink(double xmin,double ymin,double xmax,double ymax,int& p)const {
-  
-  for(GVector<HtmlLink>::iterator i=accu->begin();i!=accu->end();i++){
-    if (i->inLink(xmin,ymin,xmax,ymax)) {
+  double y;
+  int b, k;
+
+  if (!indexOk) buildIndex();
+  if (nBands==0) {
+    for(GVector<HtmlLink>::iterator i=accu->begin();i!=accu->end();i++){
+      if (i->inLink(xmin,ymin,xmax,ymax)) {
         p=(i - accu->begin());
         return 1;
+      }
     }
-   }
+    return 0;
+  }
+
+  // a link only matches if the string's middle is in (Ymin,Ymax], so
+  // the band holding that point lists every candidate
+  y=(ymin+ymax)/2;
+  if (!(y>bandY0 && y<=bandY1)) return 0;
+  b=getBand(y);
+  for(k=bandStart[b];k<bandStart[b+1];k++){
+    if ((accu->begin()+bandLinks[k])->inLink(xmin,ymin,xmax,ymax)) {
+      p=bandLinks[k];
+      return 1;
+    }
+  }
   return 0;
 }
 
@@ -41,10 +41,25 @@ public:
 class HtmlLinks{
 private:
  GVector<HtmlLink> *accu;
+
+ // Horizontal bands over the links' y range, each listing (in
+ // ascending order) the links that overlap it, so that inLink() only
+ // tests the links around the string.  Built on the first query after
+ // the links have changed.
+ mutable GBool indexOk;
+ mutable int nBands;
+ mutable double bandY0, bandY1;	// y range covered by the links
+ mutable double bandH;		// height of a band
+ mutable int *bandStart;	// band i is bandLinks[bandStart[i] ..
+				//   bandStart[i+1]-1]
+ mutable int *bandLinks;
+ void buildIndex() const;
+ int getBand(double y) const;
 public:
  HtmlLinks();
  ~HtmlLinks();
- void AddLink(const HtmlLink& x) {accu->push_back(x);}
+ void AddLink(const HtmlLink& x) {accu->push_back(x); indexOk=gFalse;}
+ // Find the first link containing the string with the given box.
  GBool inLink(double xmin,double ymin,double xmax,double ymax,int& p) const;
  HtmlLink* getLink(int i) const;
  int getNumLinks() { return accu->size();}
@@ -19,9 +19,13 @@
 #include <stdarg.h>
 #include <stddef.h>
 #include <ctype.h>
+#include <limits.h>
+#include <string.h>
+#include <unistd.h>
 #include <math.h>
 #include "GString.h"
 #include "GList.h"
+#include "GHash.h"
 #include "UnicodeMap.h"
 #include "gmem.h"
 #include "config.h"
@@ -30,27 +34,15 @@
 #include "GlobalParams.h"
 #include "HtmlOutputDev.h"
 #include "HtmlFonts.h"
+#include "HtmlWorkers.h"
+#include "HtmlWriter.h"
+#include "HtmlBinary.h"
+#include "HtmlImageCache.h"
+#include "HtmlPNG.h"
+#include "HtmlCheckpoint.h"
+#include "UTF8.h"
 
 
-int HtmlPage::pgNum=0;
-int HtmlOutputDev::imgNum=1;
-
-extern double scale;
-extern GBool complexMode;
-extern GBool ignore;
-extern GBool printCommands;
-extern GBool printHtml;
-extern GBool noframes;
-extern GBool stout;
-extern GBool xml;
-extern GBool showHidden;
-extern GBool noMerge;
-
-
-GBool HtmlOutputDev::doCoalesce = true;
-GBool HtmlOutputDev::outputPaths = true;
-GBool HtmlOutputDev::outputImages = false;
-
 void writeURL(char *str, FILE *f);
 GString *insertEntities(char *str);
 
@@ -102,7 +94,7 @@ static GString* Dirname(GString* str){
 // HtmlString
 //------------------------------------------------------------------------
 
-HtmlString::HtmlString(GfxState *state, double fontSize, double _charspace, HtmlFontAccu* fonts, double rotation) {
+HtmlString::HtmlString(GfxState *state, double fontSize, double _charspace, HtmlFontAccu* fonts, HtmlArena *arenaA, double rotation) {
   GfxFont *font;
   double x, y;
 
@@ -113,9 +105,11 @@ HtmlString::HtmlString(GfxState *state, double fontSize, double _charspace, Html
     GfxRGB rgb;
     state->getFillRGB(&rgb);
     GString *name = state->getFont()->getName();
-    if (!name) name = HtmlFont::getDefaultFont(); //new GString("default");
+    GString *defaultName = NULL;
+    if (!name) name = defaultName = HtmlFont::getDefaultFont(); //new GString("default");
    // HtmlFont hfont=HtmlFont(name, static_cast<int>(fontSize-1),_charspace, rgb);
     HtmlFont hfont = HtmlFont(name, static_cast<int>(fontSize-1),0.0, rgb);
+    if (defaultName) delete defaultName;
     hfont.isItalic(font->isItalic());
     hfont.isBold(font->isBold());
 //    hfont.isOblique(font->isOblique());
@@ -133,16 +127,14 @@ HtmlString::HtmlString(GfxState *state, double fontSize, double _charspace, Html
     yMin = y;
     yMax = y + 1;
   }
+  arena = arenaA;
   col = 0;
   text = NULL;
   xRight = NULL;
   link = NULL;
   len = size = 0;
-  yxNext = NULL;
-  xyNext = NULL;
-  strSize = 0;
-  htext = new GString();
-  htext2 = new GString();
+  htext = NULL;
+  hlen = hsize = 0;
 #ifdef HAVE_UNICODE_TEXT_DIRECTION  
   dir = textDirUnknown;
 #endif  
@@ -150,12 +142,68 @@ HtmlString::HtmlString(GfxState *state, double fontSize, double _charspace, Html
 }
 
 
-HtmlString::~HtmlString() {
-  delete text;
-  delete htext;
-  delete htext2;
-//  delete strSize;
-  gfree(xRight);
+void HtmlString::reserve(int n) {
+  Unicode *text1;
+  double *xRight1;
+
+  if (n <= size) {
+    return;
+  }
+  // the old arrays stay in the arena until the page is cleared
+  n = (n + 15) & ~15;
+  if (n < 2 * size) {
+    n = 2 * size;
+  }
+  text1 = (Unicode *)arena->alloc(n * sizeof(Unicode));
+  xRight1 = (double *)arena->alloc(n * sizeof(double));
+  if (len > 0) {
+    memcpy(text1, text, len * sizeof(Unicode));
+    memcpy(xRight1, xRight, len * sizeof(double));
+  }
+  text = text1;
+  xRight = xRight1;
+  size = n;
+}
+
+void HtmlString::reserveHtml(int n) {
+  char *htext1;
+
+  if (n <= hsize) {
+    return;
+  }
+  // as for text, the old array stays in the arena
+  n = (n + 15) & ~15;
+  if (n < 2 * hsize) {
+    n = 2 * hsize;
+  }
+  htext1 = (char *)arena->alloc(n);
+  if (hlen > 0) {
+    memcpy(htext1, htext, hlen);
+  }
+  htext = htext1;
+  hsize = n;
+}
+
+void HtmlString::setHtml(const char *s, int n) {
+  hlen = 0;
+  appendHtml(s, n);
+}
+
+void HtmlString::appendHtml(const char *s, int n) {
+  reserveHtml(hlen + n + 1);
+  memcpy(htext + hlen, s, n);
+  hlen += n;
+  htext[hlen] = '\0';
+}
+
+void HtmlString::insertHtml(GString *s) {
+  int n;
+
+  n = s->getLength();
+  reserveHtml(hlen + n + 1);
+  memmove(htext + n, htext, hlen + 1);
+  memcpy(htext, s->getCString(), n);
+  hlen += n;
 }
 
 void HtmlString::addChar(GfxState *state, double x, double y,
@@ -167,9 +215,7 @@ void HtmlString::addChar(GfxState *state, double x, double y,
 #endif
   
   if (len == size) {
-    size += 16;
-    text = (Unicode *)grealloc(text, size * sizeof(Unicode));
-    xRight = (double *)grealloc(xRight, size * sizeof(double));
+    reserve(len + 1);
   }
   text[len] = u;
   if (len == 0) {
@@ -177,7 +223,6 @@ void HtmlString::addChar(GfxState *state, double x, double y,
   }
   xMax = xRight[len] = x + dx;
   //xMax = xRight[len] = x;
-  ++strSize;
 //printf("added char: %f %f xright = %f\n", x, dx, x+dx);
   ++len;
 }
@@ -198,24 +243,41 @@ void HtmlString::endString()
 #endif  
 }
 
+// values of the truncated attribute, by HtmlTruncation
+static const char *truncationNames[] = {
+  "", "time", "memory"
+};
+
 //------------------------------------------------------------------------
 // HtmlPage
 //------------------------------------------------------------------------
 
-HtmlPage::HtmlPage(GBool rawOrder, char *imgExtVal) {
+HtmlPage::HtmlPage(HtmlParams *paramsA, GBool rawOrder, char *imgExtVal) {
+  params = paramsA;
   this->rawOrder = rawOrder;
   curStr = NULL;
-  yxStrings = NULL;
-  xyStrings = NULL;
-  yxCur1 = yxCur2 = NULL;
-  fonts=new HtmlFontAccu();
+  strs = NULL;
+  nStrs = strsSize = 0;
+  arena = new HtmlArena();
+  htmlBuf = new GString();
+  paths = new HtmlPaths();
+  fonts=new HtmlFontAccu(params->xml);
   links=new HtmlLinks();
   pageWidth=0;
   pageHeight=0;
   fontsPageMarker = 0;
   DocName=NULL;
   firstPage = -1;
+  pageNumber = 0;
+  pendingImages = new GList();
+  rotation = 0;
   imgExt = new GString(imgExtVal);
+  streamWriter = NULL;
+  fontsWritten = 0;
+  fontUsed = NULL;
+  fontUsedSize = 0;
+  truncated = htmlNotTruncated;
+  stats.clear();
   debug = 0;
 }
 
@@ -225,6 +287,12 @@ HtmlPage::~HtmlPage() {
   if (fonts) delete fonts;
   if (links) delete links;
   if (imgExt) delete imgExt;  
+  gfree(strs);
+  gfree(fontUsed);
+  delete arena;
+  delete htmlBuf;
+  delete paths;
+  delete pendingImages;
 }
 
 void HtmlPage::updateFont(GfxState *state) {
@@ -269,7 +337,8 @@ void HtmlPage::beginString(GfxState *state, GString *s) {
 //???  s is never used here.
     double rotation = computeRotation(state);
 //    fprintf(stdout, "rotation for %s = %lf\n", s->getCString(), );
-    curStr = new HtmlString(state, fontSize, charspace, fonts, rotation);
+    curStr = new (arena) HtmlString(state, fontSize, charspace, fonts, arena,
+				    rotation);
 }
 
 void HtmlPage::showStrings() {
@@ -278,10 +347,11 @@ void HtmlPage::showStrings() {
   int i;
   GString *str;
   printf("*********\n");
-  for(i = 0, tmp = yxStrings; tmp; tmp = tmp->yxNext, i++){
+  for(i = 0; i < nStrs; i++){
+     tmp = strs[i];
      int pos = tmp->fontpos;
      h = fonts->Get(pos);
-     str = HtmlFont::simple(h, tmp->text, tmp->len);
+     str = HtmlFont::simple(h, tmp->text, tmp->len, params->uMap);
      printf("%d) %s\n", i+1, str->getCString());
   }
   printf("-----------\n");
@@ -294,19 +364,15 @@ void HtmlPage::conv(){
   int linkIndex = 0;
   HtmlFont* h;
 
-  for(tmp=yxStrings;tmp;tmp=tmp->yxNext){
+  for(int i = 0; i < nStrs; i++){
+     tmp=strs[i];
      int pos=tmp->fontpos;
      //  printf("%d\n",pos);
      h=fonts->Get(pos);
 
-     if (tmp->htext) delete tmp->htext; 
-     tmp->htext=HtmlFont::simple(h,tmp->text,tmp->len);
-     tmp->htext2=HtmlFont::simple(h,tmp->text,tmp->len);
-
-     if(strncmp(tmp->htext->getCString(), "Kernel", 7) == 0) {
-       printf("okay\n");
-     }
-
+     htmlBuf->clear();
+     HtmlFont::simple(htmlBuf,h,tmp->text,tmp->len,params->uMap);
+     tmp->setHtml(htmlBuf->getCString(),htmlBuf->getLength());
 
      if (links->inLink(tmp->xMin,tmp->yMin,tmp->xMax,tmp->yMax, linkIndex)){
        tmp->link = links->getLink(linkIndex);
@@ -324,6 +390,7 @@ void HtmlPage::addChar(GfxState *state, double x, double y,
 			double ox, double oy, Unicode *u, int uLen) {
   double x1, y1, w1, h1, dx2, dy2;
   int n, i, d;
+  ++stats.chars;
   state->transform(x, y, &x1, &y1);
   n = curStr->len;
   d = 0;
@@ -376,21 +443,25 @@ void HtmlPage::addChar(GfxState *state, double x, double y,
 }
 
 void HtmlPage::endString() {
-  HtmlString *p1, *p2;
-  double h, y1, y2;
-
 
   // throw away zero-length strings -- they don't have valid xMin/xMax
   // values, and they're useless anyway
   if (curStr->len == 0) {
     delete curStr;
     curStr = NULL;
+    if (streamWriter)
+      arena->reset();
     return;
   }
 
   // printf("endString %s\n", curStr->getCString());
   curStr->endString();
 
+  if (streamWriter) {
+    streamString();
+    return;
+  }
+
 #if 0 //~tmp
   if (curStr->yMax - curStr->yMin > 20) {
     delete curStr;
@@ -399,52 +470,283 @@ void HtmlPage::endString() {
   }
 #endif
 
-  // insert string in y-major list
-  h = curStr->yMax - curStr->yMin;
-  y1 = curStr->yMin + 0.5 * h;
-  y2 = curStr->yMin + 0.8 * h;
-  if (rawOrder) {
-    p1 = yxCur1;
-    p2 = NULL;
-  } else if ((!yxCur1 ||
-              (y1 >= yxCur1->yMin &&
-               (y2 >= yxCur1->yMax || curStr->xMax >= yxCur1->xMin))) &&
-             (!yxCur2 ||
-              (y1 < yxCur2->yMin ||
-               (y2 < yxCur2->yMax && curStr->xMax < yxCur2->xMin)))) {
-    p1 = yxCur1;
-    p2 = yxCur2;
+  if (nStrs == strsSize) {
+    strsSize = strsSize ? 2 * strsSize : 256;
+    strs = (HtmlString **)greallocn(strs, strsSize, sizeof(HtmlString *));
+  }
+  strs[nStrs++] = curStr;
+  curStr = NULL;
+  ++stats.strings;
+}
+
+// True if <str1> comes before <str2> in y-major order: it is on an
+// earlier line, or on the same line and to the left.
+GBool HtmlPage::precedes(HtmlString *str1, HtmlString *str2) {
+  double h = str1->yMax - str1->yMin;
+  double y1 = str1->yMin + 0.5 * h;
+  double y2 = str1->yMin + 0.8 * h;
+
+  return y1 < str2->yMin || (y2 < str2->yMax && str1->xMax < str2->xMin);
+}
+
+// Stable merge sort with precedes().  A string only moves in front of
+// an earlier one that it precedes, which is where inserting the
+// strings one by one into a y-major list used to put it.
+void HtmlPage::sortStrings() {
+  HtmlString **src, **dst, **t;
+  int width, lo, mid, hi, i, j, k;
+
+  if (rawOrder || nStrs < 2) {
+    return;
+  }
+  src = strs;
+  dst = (HtmlString **)gmallocn(nStrs, sizeof(HtmlString *));
+  for (width = 1; width < nStrs; width *= 2) {
+    for (lo = 0; lo < nStrs; lo += 2 * width) {
+      mid = lo + width < nStrs ? lo + width : nStrs;
+      hi = lo + 2 * width < nStrs ? lo + 2 * width : nStrs;
+      i = lo;
+      j = mid;
+      k = lo;
+      while (i < mid && j < hi) {
+	if (precedes(src[j], src[i])) {
+	  dst[k++] = src[j++];
+	} else {
+	  dst[k++] = src[i++];
+	}
+      }
+      while (i < mid) {
+	dst[k++] = src[i++];
+      }
+      while (j < hi) {
+	dst[k++] = src[j++];
+      }
+    }
+    t = src;
+    src = dst;
+    dst = t;
+  }
+  if (src != strs) {
+    memcpy(strs, src, nStrs * sizeof(HtmlString *));
+    dst = src;
+  }
+  gfree(dst);
+}
+
+//------------------------------------------------------------------------
+// baseline bands
+//------------------------------------------------------------------------
+
+// Strings of one rotation whose vertical centers are within half a
+// string height of the band's first string: a line of text, with its
+// strings in any order.
+struct HtmlBand {
+  double center;		// vertical center of the first string
+  double rotation;
+  int first, last;		// first and last string, by page order
+  int next;			// next band in the same hash bucket
+};
+
+// Hash bucket of coalesce() key <key>: the one that holds it, or the
+// empty one where it goes.
+static int findBandBucket(int *keys, int *heads, int mask, int key) {
+  int h;
+
+  h = (int)(((unsigned int)key * 2654435761U) & (unsigned int)mask);
+  while (heads[h] >= 0 && keys[h] != key) {
+    h = (h + 1) & mask;
+  }
+  return h;
+}
+
+static int bandKey(double y, double step) {
+  double q;
+
+  q = floor(y / step);
+  // coordinates can be anything
+  if (q < -1e9) {
+    return -1000000000;
+  }
+  if (q > 1e9) {
+    return 1000000000;
+  }
+  return (int)q;
+}
+
+// Bucket the strings into baseline bands, in one pass.  A string goes
+// to the closest band within half its height, looked for through a
+// hash on the vertical center, in steps of the mean string height.
+// Returns the bands (*<nBands> of them, in the order of their first
+// strings), and sets <next>[i] to the string after strs[i] in its
+// band, or -1.
+HtmlBand *HtmlPage::makeBands(int *next, int *nBands) {
+  HtmlBand *bands;
+  HtmlString *str;
+  int *keys, *heads;
+  double step, h, c, d, bestD;
+  int hashSize, n, best, q, q1, i, k, b;
+
+  step = 0;
+  for (i = 0; i < nStrs; i++) {
+    step += strs[i]->yMax - strs[i]->yMin;
+  }
+  step /= nStrs;
+  if (!(step >= 1)) {
+    step = 1;
+  }
+  for (hashSize = 64; hashSize < 2 * nStrs; hashSize *= 2) ;
+  keys = (int *)gmallocn(hashSize, sizeof(int));
+  heads = (int *)gmallocn(hashSize, sizeof(int));
+  for (i = 0; i < hashSize; i++) {
+    heads[i] = -1;
+  }
+  bands = (HtmlBand *)gmallocn(nStrs, sizeof(HtmlBand));
+  n = 0;
+
+  for (i = 0; i < nStrs; i++) {
+    str = strs[i];
+    h = str->yMax - str->yMin;
+    c = str->yMin + 0.5 * h;
+    best = -1;
+    bestD = 0;
+    q1 = bandKey(c + 0.5 * h, step);
+    for (q = bandKey(c - 0.5 * h, step); q <= q1; q++) {
+      k = findBandBucket(keys, heads, hashSize - 1, q);
+      for (b = heads[k]; b >= 0; b = bands[b].next) {
+	d = fabs(bands[b].center - c);
+	if (bands[b].rotation == str->rotation_ && d < 0.5 * h &&
+	    (best < 0 || d < bestD)) {
+	  best = b;
+	  bestD = d;
+	}
+      }
+    }
+    next[i] = -1;
+    if (best >= 0) {
+      next[bands[best].last] = i;
+      bands[best].last = i;
+    } else {
+      q = bandKey(c, step);
+      k = findBandBucket(keys, heads, hashSize - 1, q);
+      keys[k] = q;
+      bands[n].center = c;
+      bands[n].rotation = str->rotation_;
+      bands[n].first = bands[n].last = i;
+      bands[n].next = heads[k];
+      heads[k] = n;
+      n++;
+    }
+  }
+
+  gfree(keys);
+  gfree(heads);
+  *nBands = n;
+  return bands;
+}
+
+// True if <str2> continues <str1> (which may already hold merged
+// strings): it is on the same baseline band and close enough, or it
+// is the next line of a paragraph.  Strings in different fonts
+// (which includes the color), directions or rotations are never
+// merged.
+GBool HtmlPage::canMerge(HtmlString *str1, HtmlString *str2) {
+  double space, horSpace, vertSpace, vertOverlap;
+  GBool addLineBreak;
+
+  if (str2->fontpos != str1->fontpos ||
+#ifdef HAVE_UNICODE_TEXT_DIRECTION          
+      str1->dir != str2->dir ||
+#endif        
+      str2->rotation_ != str1->rotation_) {
+    return gFalse;
+  }
+
+  space = str1->yMax - str1->yMin;
+  horSpace = str2->xMin - str1->xMax;
+  addLineBreak = !params->noMerge && (fabs(str1->xMin - str2->xMin) < 0.4);
+  vertSpace = str2->yMin - str1->yMax;
+
+  if (str2->yMin >= str1->yMin && str2->yMin <= str1->yMax) {
+    vertOverlap = str1->yMax - str2->yMin;
+  } else if (str2->yMax >= str1->yMin && str2->yMax <= str1->yMax) {
+    vertOverlap = str2->yMax - str1->yMin;
   } else {
-    for (p1 = NULL, p2 = yxStrings; p2; p1 = p2, p2 = p2->yxNext) {
-      if (y1 < p2->yMin || (y2 < p2->yMax && curStr->xMax < p2->xMin))
-        break;
+    vertOverlap = 0;
+  }
+
+  return (((rawOrder && vertOverlap > 0.5 * space) ||
+	   (!rawOrder && str2->yMin < str1->yMax)) &&
+	  (horSpace > -0.5 * space && horSpace < space)) ||
+         (vertSpace >= 0 && vertSpace < 0.5 * space && addLineBreak);
+}
+
+// Append <str2> to <str1>, separated by a space or line break as
+// needed.  <str2> is left for the caller to delete.
+void HtmlPage::merge(HtmlString *str1, HtmlString *str2) {
+  double space, horSpace;
+  GBool addSpace, addLineBreak;
+  HtmlLink *hlink1, *hlink2;
+
+  space = str1->yMax - str1->yMin;
+  horSpace = str2->xMin - str1->xMax;
+  addLineBreak = !params->noMerge && (fabs(str1->xMin - str2->xMin) < 0.4);
+  addSpace = horSpace > 0.1 * space;
+
+  str1->reserve(str1->len + str2->len + 2);
+  if (addSpace) {
+    str1->text[str1->len] = 0x20;
+    str1->appendHtml(" ", 1);
+    str1->xRight[str1->len] = str2->xMin;
+    ++str1->len;
+  }
+  if (addLineBreak) {
+    str1->text[str1->len] = '\n';
+    str1->appendHtml("<br>");
+    str1->xRight[str1->len] = str2->xMin;
+    ++str1->len;
+    str1->yMin = str2->yMin;
+    str1->yMax = str2->yMax;
+    str1->xMax = str2->xMax;
+  }
+  memcpy(str1->text + str1->len, str2->text, str2->len * sizeof(Unicode));
+  memcpy(str1->xRight + str1->len, str2->xRight, str2->len * sizeof(double));
+  str1->len += str2->len;
+
+  hlink1 = str1->getLink();
+  hlink2 = str2->getLink();
+  if (!hlink1 || !hlink2 || !hlink1->isEqualDest(*hlink2)) {
+    if (hlink1) {
+      str1->appendHtml("</a>");
+    }
+    if (hlink2) {
+      GString *ls = hlink2->getLinkStart();
+      str1->appendHtml(ls);
+      delete ls;
     }
-    yxCur2 = p2;
   }
-  yxCur1 = curStr;
-  if (p1)
-    p1->yxNext = curStr;
-  else
-    yxStrings = curStr;
-  curStr->yxNext = p2;
-  curStr = NULL;
+  str1->appendHtml(str2->htext, str2->hlen);
+  // str1 now contains href for link of str2 (if it is defined)
+  str1->link = str2->link;
+
+  if (str2->xMax > str1->xMax) {
+    str1->xMax = str2->xMax;
+  }
+  if (str2->yMax > str1->yMax) {
+    str1->yMax = str2->yMax;
+  }
 }
 
 void HtmlPage::coalesce() {
   HtmlString *str1, *str2;
-  HtmlFont *hfont1, *hfont2;
-  double space, horSpace, vertSpace, vertOverlap;
-  GBool addSpace, addLineBreak;
-  int n, i;
-  double curX, curY, lastX, lastY;
-  int sSize = 0;      
-  double diff = 0.0;
-  double pxSize = 0.0;
-  double strSize = 0.0;
-  double cspace = 0.0;
+  HtmlBand *bands;
+  HtmlLink **firstLink;
+  double curX, curY;
+  int *next;
+  int nBands, b, i, j, k;
 
 #if 0 //~ for debugging
-  for (str1 = yxStrings; str1; str1 = str1->yxNext) {
+  for (j = 0; j < nStrs; j++) {
+    str1 = strs[j];
     printf("x=%f..%f  y=%f..%f  size=%2d fontpos=%d '",
 	   str1->xMin, str1->xMax, str1->yMin, str1->yMax,
 	   (int)(str1->yMax - str1->yMin), str1->fontpos);
@@ -455,274 +757,129 @@ void HtmlPage::coalesce() {
   }
   printf("\n------------------------------------------------------------\n\n");
 #endif
-  str1 = yxStrings;
-
-  if( !str1 ) return;
+  if( nStrs == 0 ) return;
 
   //----- discard duplicated text (fake boldface, drop shadows)
-  if( !complexMode )
+  if( !params->complexMode )
   {
 	HtmlString *str3;
-	GBool found;
-  	while (str1)
+	// duplicates are set to NULL, then squeezed out
+	for (i = 0; i < nStrs; i++)
 	{
+		if (!(str1 = strs[i]))
+			continue;
 		double size = str1->yMax - str1->yMin;
 		double xLimit = str1->xMin + size * 0.2;
-		found = gFalse;
-		for (str2 = str1, str3 = str1->yxNext;
-			str3 && str3->xMin < xLimit;
-			str2 = str3, str3 = str2->yxNext)
+		for (j = i + 1; j < nStrs; j++)
 		{
+			if (!(str3 = strs[j]))
+				continue;
+			if (str3->xMin >= xLimit)
+				break;
 			if (str3->len == str1->len &&
 				!memcmp(str3->text, str1->text, str1->len * sizeof(Unicode)) &&
 				fabs(str3->yMin - str1->yMin) < size * 0.2 &&
 				fabs(str3->yMax - str1->yMax) < size * 0.2 &&
 				fabs(str3->xMax - str1->xMax) < size * 0.2)
 			{
-				found = gTrue;
 				//fprintf(stderr, "found duplicate!\n");
-				break;
+				delete str3;
+				strs[j] = NULL;
 			}
 		}
-		if (found)
-		{
-			str2->xyNext = str3->xyNext;
-			str2->yxNext = str3->yxNext;
-			delete str3;
-		}
-		else
-		{
-			str1 = str1->yxNext;
-		}
 	}		
+	for (i = k = 0; i < nStrs; i++)
+		if (strs[i])
+			strs[k++] = strs[i];
+	nStrs = k;
   }
-  
-  str1 = yxStrings;
-  
-  hfont1 = getFont(str1);
 
-  str1->htext2->append(str1->htext);
-  if( str1->getLink() != NULL ) {
-    GString *ls = str1->getLink()->getLinkStart();
-    str1->htext->insert(0, ls);
-    delete ls;
+  //----- merge
+  // Each band's strings (makeBands), in page order, are merged into
+  // runs in a single pass: a string that can't extend the band's
+  // current run starts the next one.  Merged strings are deleted, and
+  // the runs are kept in the order of their first strings.  Links are
+  // opened and closed around each run at the end, so firstLink keeps
+  // the link each run starts with.
+  next = (int *)gmallocn(nStrs, sizeof(int));
+  firstLink = (HtmlLink **)gmallocn(nStrs, sizeof(HtmlLink *));
+  for (i = 0; i < nStrs; i++) {
+    firstLink[i] = strs[i]->getLink();
   }
-  curX = str1->xMin; curY = str1->yMin;
-  lastX = str1->xMin; lastY = str1->yMin;
-
-  int openSpan = 0;
-
-  while (str1 && (str2 = str1->yxNext)) {
-    hfont2 = getFont(str2);
-    space = str1->yMax - str1->yMin;
-    horSpace = str2->xMin - str1->xMax;
-    addLineBreak = !noMerge && (fabs(str1->xMin - str2->xMin) < 0.4);
-    vertSpace = str2->yMin - str1->yMax;
-
-//printf("coalesce %d %d %f? ", str1->dir, str2->dir, d);
-
-    if (str2->yMin >= str1->yMin && str2->yMin <= str1->yMax)
-    {
-	vertOverlap = str1->yMax - str2->yMin;
-    } else
-    if (str2->yMax >= str1->yMin && str2->yMax <= str1->yMax)
-    {
-	vertOverlap = str2->yMax - str1->yMin;
-    } else
-    {
-    	vertOverlap = 0;
-    } 
-    
-    if (
-	(
-	 (
-	  (
-	   (rawOrder && vertOverlap > 0.5 * space) 
-	   ||
-	   (!rawOrder && str2->yMin < str1->yMax)
-	  ) &&
-	  (horSpace > -0.5 * space && horSpace < space)
-	 ) ||
-       	 (vertSpace >= 0 && vertSpace < 0.5 * space && addLineBreak)
-	) &&
- // in complex mode fonts must be the same, in other modes fonts do not metter
-#ifdef HAVE_UNICODE_TEXT_DIRECTION          
-	str1->dir == str2->dir // text direction the same
-#else
-          1
-#endif        
-        && str2->fontpos == str1->fontpos
-       ) 
-    {
-     diff = str2->xMax - str1->xMin;
-
-     n = str1->len + str2->len;
-     if ((addSpace = horSpace > 0.1 * space)) {
-        ++n;
-      }
-    
-      if (addLineBreak) {
-        ++n;
-      }
-  
-      str1->size = (n + 15) & ~15;
-      str1->text = (Unicode *)grealloc(str1->text,
-				       str1->size * sizeof(Unicode));
-      str1->xRight = (double *)grealloc(str1->xRight,
-					str1->size * sizeof(double));
-      if (addSpace) {
-		/*  if (addSpace > (xoutRoundLower(hfont1->getSize()/scale)))
-		  {
-		  	str1->text[str1->len] = 0x20;
-			str1->htext->append(" ");
-			str1->htext2->append(" ");
-			str1->xRight[str1->len] = str2->xMin;
-			++str1->len;
-			++str1->strSize;
-		 } */
-  	   	 str1->text[str1->len] = 0x20;
-                 str1->htext->append(" ");
-                 str1->htext2->append(" ");
-                 str1->xRight[str1->len] = str2->xMin;
-                 ++str1->len;
-                ++str1->strSize;
-      }
-      if (addLineBreak) {
-	  str1->text[str1->len] = '\n';
-	  str1->htext->append("<br>");
-	  str1->htext2->append(" ");
-	  str1->xRight[str1->len] = str2->xMin;
-	  ++str1->len;
-	  str1->yMin = str2->yMin;
-	  str1->yMax = str2->yMax;
-	  str1->xMax = str2->xMax;
-	  int fontLineSize = hfont1->getLineSize();
-	  int curLineSize = (int)(vertSpace + space); 
-
-	  if( curLineSize != fontLineSize )
-	  {
-	      HtmlFont *newfnt = new HtmlFont(*hfont1);
-	      newfnt->setLineSize(curLineSize);
-	      str1->fontpos = fonts->AddFont(*newfnt);
-	      delete newfnt;
-	      hfont1 = getFont(str1);
-	      // we have to reget hfont2 because it's location could have
-	      // changed on resize  GStri;ng *iStr=GString::fromInt(i);
-	      hfont2 = getFont(str2); 
-	  }
-
-      }
-
-      str1->htext2->append(str2->htext2);
-
-      HtmlLink *hlink1 = str1->getLink();
-      HtmlLink *hlink2 = str2->getLink();
-
-
-      if ( 0 &&      ((hlink1 == NULL) && (hlink2 == NULL)) && (hfont1->isEqualIgnoreBold(*hfont2) == gFalse))
-      {
-          GString *fntFix;
-          GString *iStr=GString::fromInt(str2->fontpos);     
-          fntFix = new GString(openSpan ? "</span><span class=\"ft" : "<span class=\"ft");
-          fntFix->append(iStr);
-          fntFix->append("\">");
-
-          str1->htext->append(fntFix);
-          openSpan = 1;
-      }
-      for (i = 0; i < str2->len; ++i) {
-	str1->text[str1->len] = str2->text[i];
-	str1->xRight[str1->len] = str2->xRight[i];
-	++str1->len;
-      }
-
-      if( !hlink1 || !hlink2 || !hlink1->isEqualDest(*hlink2) ) {
-	if(hlink1 != NULL )
-	  str1->htext->append("</a>");
-	if(hlink2 != NULL ) {
-	  GString *ls = hlink2->getLinkStart();
-	  str1->htext->append(ls);
-	  delete ls;
-	}
-      }
-
-      str1->htext->append(str2->htext);
-      sSize = str1->htext2->getLength();      
-      pxSize = xoutRoundLower(hfont1->getSize()/scale);
-      strSize = (pxSize*(sSize-2));   
-      cspace = (diff / strSize);//(strSize-pxSize));
-     // we check if the fonts are the same and create a new font to ajust the text
-//      double diff = str2->xMin - str1->xMin;
-//      printf("%s\n",str1->htext2->getCString());
-      // str1 now contains href for link of str2 (if it is defined)
-      str1->link = str2->link; 
-
-      HtmlFont *newfnt = new HtmlFont(*hfont1);
-      newfnt->setCharSpace(cspace);
-      //newfnt->setLineSize(curLineSize);
-      str1->fontpos = fonts->AddFont(*newfnt);
-      delete newfnt;
-      hfont1 = getFont(str1);
-      // we have to reget hfont2 because it's location could have
-      // changed on resize  GString *iStr=GString::fromInt(i);
-      hfont2 = getFont(str2); 
-
-      hfont1 = hfont2;
-
-      if (str2->xMax > str1->xMax) {
-	str1->xMax = str2->xMax;
-      }
-
-      if (str2->yMax > str1->yMax) {
-	str1->yMax = str2->yMax;
+  bands = makeBands(next, &nBands);
+  for (b = 0; b < nBands; b++) {
+    i = bands[b].first;
+    curX = strs[i]->xMin; curY = strs[i]->yMin;
+    for (j = next[i]; j >= 0; j = next[j]) {
+      str1 = strs[i];
+      str2 = strs[j];
+      if (canMerge(str1, str2)) {
+	merge(str1, str2);
+	delete str2;
+	strs[j] = NULL;
+      } else {
+	str1->xMin = curX; str1->yMin = curY;
+	i = j;
+	curX = str2->xMin; curY = str2->yMin;
       }
+    }
+    strs[i]->xMin = curX; strs[i]->yMin = curY;
+  }
+  gfree(bands);
+  gfree(next);
+  for (i = k = 0; i < nStrs; i++) {
+    if (strs[i]) {
+      strs[k] = strs[i];
+      firstLink[k] = firstLink[i];
+      k++;
+    }
+  }
+  nStrs = k;
 
-      str1->yxNext = str2->yxNext;
-
-      delete str2;
-    } else { 
-
-//     printf("startX = %f, endX = %f, diff = %f, fontsize = %d, pxSize = %f, stringSize = %d, cspace = %f, strSize = %f\n",str1->xMin,str1->xMax,diff,hfont1->getSize(),pxSize,sSize,cspace,strSize);
-
-// keep strings separate
-//      printf("no\n"); 
-//      if( hfont1->isBold() )
-      if(str1->getLink() != NULL )
-	str1->htext->append("</a>");  
-     
-      str1->xMin = curX; str1->yMin = curY; 
-      str1 = str2;
+  // the next line of a paragraph is in another band, but it follows
+  // the run it continues
+  if (!params->noMerge) {
+    for (i = k = 0; i < nStrs; i = j, k++) {
+      str1 = strs[i];
       curX = str1->xMin; curY = str1->yMin;
-      hfont1 = hfont2;
-
-      if( str1->getLink() != NULL ) {
-	GString *ls = str1->getLink()->getLinkStart();
-	str1->htext->insert(0, ls);
-	delete ls;
+      for (j = i + 1; j < nStrs && canMerge(str1, (str2 = strs[j])); j++) {
+	merge(str1, str2);
+	delete str2;
       }
+      str1->xMin = curX; str1->yMin = curY;
+      strs[k] = str1;
+      firstLink[k] = firstLink[i];
     }
+    nStrs = k;
   }
-  str1->xMin = curX; str1->yMin = curY;
 
-  if(str1->getLink() != NULL )
-    str1->htext->append("</a>");
-
-  if(openSpan)
-      str1->htext->append("</span>");
+  for (i = 0; i < nStrs; i++) {
+    str1 = strs[i];
+    if (firstLink[i]) {
+      GString *ls = firstLink[i]->getLinkStart();
+      str1->insertHtml(ls);
+      delete ls;
+    }
+    if (str1->getLink() != NULL) {
+      str1->appendHtml("</a>");
+    }
+  }
+  gfree(firstLink);
 
 #if 0 //~ for debugging
-  for (str1 = yxStrings; str1; str1 = str1->yxNext) {
+  for (j = 0; j < nStrs; j++) {
+    str1 = strs[j];
     printf("x=%3d..%3d  y=%3d..%3d  size=%2d ",
 	   (int)str1->xMin, (int)str1->xMax, (int)str1->yMin, (int)str1->yMax,
 	   (int)(str1->yMax - str1->yMin));
-    printf("'%s'\n", str1->htext->getCString());  
+    printf("'%s'\n", str1->htext);
   }
   printf("\n------------------------------------------------------------\n\n");
 #endif
 
 }
 
-void HtmlPage::dumpImagesAsXML(FILE* f)
+void HtmlPage::dumpImagesAsXML(HtmlWriter *w)
 {
     int i = 0;
     Image *img;
@@ -730,11 +887,11 @@ void HtmlPage::dumpImagesAsXML(FILE* f)
 // printf("# images on page %d = %d\n", pageNumber, images.getLength());
     for(i = 0 ; i < images.getLength(); i++) {
         img = (Image*) images.get(i);
-        img->dumpAsXML(f);
+        img->dumpAsXML(w);
     }
 }
 
-void HtmlPage::dumpLinksAsXML(FILE* f)
+void HtmlPage::dumpLinksAsXML(HtmlWriter *w)
 {
     int i = 0;
     HtmlLink *l; // = links->getLink(i);
@@ -744,9 +901,17 @@ void HtmlPage::dumpLinksAsXML(FILE* f)
         l = links->getLink(i);
         GString *lstr = l->getDest();
         char *str = lstr->getCString();
-        fprintf(f, "<ulink url=\"");
-        writeURL(str, f);
-        fprintf(f, "\" x1=\"%.3lf\" y1=\"%.3lf\" x2=\"%.3lf\"  y2=\"%.3lf\" />\n", l->getX1(), l->getY1(), l->getX2(), l->getY2());
+        w->put("<ulink url=\"");
+        w->putXMLAttr(str);
+        w->put("\" x1=\"");
+        w->putDouble(l->getX1(), params->coordPrecision);
+        w->put("\" y1=\"");
+        w->putDouble(l->getY1(), params->coordPrecision);
+        w->put("\" x2=\"");
+        w->putDouble(l->getX2(), params->coordPrecision);
+        w->put("\"  y2=\"");
+        w->putDouble(l->getY2(), params->coordPrecision);
+        w->put("\" />\n");
         delete lstr;
     }
 }
@@ -813,83 +978,137 @@ toDegrees(double radians)
     return(val);
 }
 
-void HtmlPage::dumpAsXML(FILE* f, int page){  
-  fprintf(f, "<page number=\"%d\" position=\"absolute\"", page);
-  fprintf(f," top=\"0\" left=\"0\" width=\"%d\" height=\"%d\" rotation=\"%lf\">\n", pageWidth, pageHeight, rotation);
-    
-  for(int i=fontsPageMarker;i < fonts->size();i++) {
+// The <page> start tag.  With <final> false (-stream), the attributes
+// that are only known at the end of the page are left out.
+void HtmlPage::dumpPageStartAsXML(HtmlWriter *w, int page, GBool final) {
+  w->put("<page number=\"");
+  w->putInt(page);
+  w->put("\" position=\"absolute\" top=\"0\" left=\"0\" width=\"");
+  w->putInt(pageWidth);
+  w->put("\" height=\"");
+  w->putInt(pageHeight);
+  w->put("\" rotation=\"");
+  w->putDouble(rotation, 6);
+  if(final && paths->getNumOmitted() > 0) {
+    // the page went over the -maxpoints budget
+    w->put("\" pathPoints=\"");
+    w->putInt(paths->getTotalPoints());
+    w->put("\" pathsOmitted=\"");
+    w->putInt(paths->getNumOmitted());
+  }
+  if (final && truncated != htmlNotTruncated) {
+    w->put("\" truncated=\"");
+    w->put(truncationNames[truncated]);
+  }
+  w->put("\">\n");
+}
+
+// fontspec elements for fonts <first> .. <last> - 1
+void HtmlPage::dumpFontSpecsAsXML(HtmlWriter *w, int first, int last) {
+  for(int i = first; i < last; i++) {
     GString *fontCSStyle = fonts->CSStyle(i);
-    fprintf(f,"\t%s\n",fontCSStyle->getCString());
+    w->put('\t');
+    w->put(fontCSStyle);
+    w->put('\n');
     delete fontCSStyle;
   }
-  
-
-  dumpLinksAsXML(f);
-  dumpImagesAsXML(f);
+}
 
+void HtmlPage::dumpTextAsXML(HtmlWriter *w, HtmlString *tmp) {
   GString *str, *str1;
-  for(HtmlString *tmp = yxStrings; tmp ;  tmp = tmp->yxNext){
-    if (tmp->htext){
-      str=new GString(tmp->htext);
-      fprintf(f,"<text top=\"%d\" left=\"%d\" ", xoutRound(tmp->yMin), xoutRound(tmp->xMin));
-      fprintf(f,"width=\"%d\" height=\"%d\" ", xoutRound(tmp->xMax - tmp->xMin), xoutRound(tmp->yMax - tmp->yMin));
-      fprintf(f,"font=\"%d\" ", tmp->fontpos);
-      fprintf(f,"rotation=\"%lf\">", toDegrees(tmp->rotation_));
-      if (tmp->fontpos!=-1){
-	str1=fonts->getCSStyle(tmp->fontpos, str);
-      }
-      const char *xstr = str1->getCString();
-      for(int j = 0; j < strlen(xstr); j++) {
-          if(xstr[j] == '\f')
-              continue;
-          else if(xstr[j] == '\n' || xstr[j] == '\r')
-              fprintf(f, "\n");
-          else
-              fprintf(f, "%c", xstr[j]);    //fputs(str,f);
-          if(xstr[j] == '&')
-              fputs("amp;", f);
-      }
-      delete str;
-      delete str1;
-      fputs("</text>\n",f);
-    }
-  }
 
+  str=new GString(tmp->htext, tmp->hlen);
+  w->put("<text top=\"");
+  w->putInt(xoutRound(tmp->yMin));
+  w->put("\" left=\"");
+  w->putInt(xoutRound(tmp->xMin));
+  w->put("\" width=\"");
+  w->putInt(xoutRound(tmp->xMax - tmp->xMin));
+  w->put("\" height=\"");
+  w->putInt(xoutRound(tmp->yMax - tmp->yMin));
+  w->put("\" font=\"");
+  w->putInt(tmp->fontpos);
+  w->put("\" rotation=\"");
+  w->putDouble(toDegrees(tmp->rotation_), 6);
+  w->put("\">");
+  if (tmp->fontpos!=-1){
+    str1=fonts->getCSStyle(tmp->fontpos, str);
+  }
+  w->putXMLText(str1->getCString());
+  delete str;
+  delete str1;
+  w->put("</text>\n");
+}
 
-  for(int i = 0; i < paths.getLength() ; i++) {
-    GfxPath *p = (GfxPath *) paths.get(i);
-    PathStateInfo *info = (PathStateInfo *) pathsInfo.get(i);
-    int nsubs = p->getNumSubpaths();
+// the recorded paths, then the shadings
+void HtmlPage::dumpPathsAsXML(HtmlWriter *w) {
+  for(int i = 0; i < paths->getNumPaths() ; i++) {
+    int sub = paths->getFirstSubpath(i);
+    int nsubs = paths->getNumSubpaths(i);
 
     if(nsubs > 1) {
-      fprintf(f, "<paths n=\"%d\">", nsubs);
+      w->put("<paths n=\"");
+      w->putInt(nsubs);
+      w->put("\">");
+
+      for(int j = sub; j < sub + nsubs; j++)
+  	  dumpAsXML(w, paths->getX(j), paths->getY(j),
+		    paths->getNumPoints(j), NULL, true);
+      w->put("</paths>\n");
+    } else if(nsubs == 1)
+        dumpAsXML(w, paths->getX(sub), paths->getY(sub),
+		  paths->getNumPoints(sub), paths->getStyle(i), false);
+  }
+  for(int i = 0; i < paths->getNumShadings(); i++)
+    paths->getShading(i)->dumpAsXML(w, params->coordPrecision);
+}
 
-      for(int j = 0; j < nsubs; j++)
-  	  dumpAsXML(f, p->getSubpath(j), NULL, true);
-      fprintf(f, "</paths>\n");
-    } else
-        dumpAsXML(f, p->getSubpath(0), info, false);
+void HtmlPage::dumpAsXML(HtmlWriter *w, int page){  
+  dumpPageStartAsXML(w, page, gTrue);
+  dumpFontSpecsAsXML(w, fontsPageMarker, fonts->size());
+
+  dumpLinksAsXML(w);
+  dumpImagesAsXML(w);
+
+  for(int i = 0; i < nStrs; i++){
+    if (strs[i]->htext)
+      dumpTextAsXML(w, strs[i]);
   }
 
-  fputs("</page>\n",f);
+  dumpPathsAsXML(w);
+
+  w->put("</page>\n");
 }
 
-void HtmlPage::dumpAsXML(FILE *f, GfxSubpath *sp, PathStateInfo *info, bool indent) {
-  int n = sp->getNumPoints();
- 
+// "x0,y0,x1,y1" with <prec> decimals
+static void putBBox(HtmlWriter *w, double x0, double y0, double x1, double y1,
+		    int prec)
+{
+  w->putDouble(x0, prec);
+  w->put(',');
+  w->putDouble(y0, prec);
+  w->put(',');
+  w->putDouble(x1, prec);
+  w->put(',');
+  w->putDouble(y1, prec);
+}
+
+void HtmlPage::dumpAsXML(HtmlWriter *w, double *xs, double *ys, int n,
+			 HtmlPathStyle *style, bool indent) {
+
   if(n == 4 || n == 5) {
     // check to see if we have a rectangle.
 
-    double x0 = sp->getX(0);
-    double x3 = sp->getX(3);
-    double x1 = sp->getX(1);
-    double x2 = sp->getX(2);
-    double y0 = sp->getY(0);
-    double y3 = sp->getY(3);
-    double y1 = sp->getY(1);
-    double y2 = sp->getY(2);
-    double x4 = n == 5 ? sp->getX(4) : x0;
-    double y4 = n == 5 ? sp->getY(4) : y0;
+    double x0 = xs[0];
+    double x3 = xs[3];
+    double x1 = xs[1];
+    double x2 = xs[2];
+    double y0 = ys[0];
+    double y3 = ys[3];
+    double y1 = ys[1];
+    double y2 = ys[2];
+    double x4 = n == 5 ? xs[4] : x0;
+    double y4 = n == 5 ? ys[4] : y0;
 
     if( (x0 == x3 && x1 == x2 && y0 == y1 && y2 == y3 && x0 == x4 && y0 == y4) || 
         (x0 == x1 && x2 == x3 && y1 == y2 && y0 == y4 && x0 == x4 && y0 == y4)) {
@@ -901,70 +1120,677 @@ void HtmlPage::dumpAsXML(FILE *f, GfxSubpath *sp, PathStateInfo *info, bool inde
         p0 = (x, y),   p1 = (x+w, y)
 
 */
-        fprintf(f, "%s<rect bbox=\"%.3lf,%.3lf,%.3lf,%.3lf\" ", 
-                      indent ? "\n   " : "",
-                x0, y0, x2, y2);
+        if(indent)
+            w->put("\n   ");
+        w->put("<rect bbox=\"");
+        putBBox(w, x0, y0, x2, y2, params->coordPrecision);
+        w->put("\" ");
 
-        if(info)
-            info->dumpAsXMLAttrs(f);
+        if(style)
+            paths->dumpStyleAsXMLAttrs(w, style, params->coordPrecision);
 
-        fprintf(f, "/>\n");
+        w->put("/>\n");
 #else
-      fprintf(f, "%s<rect>", indent ? "\n   " : "");
+      w->printf("%s<rect>", indent ? "\n   " : "");
       for(int i = 0; i < 4; i++)
-  	  fprintf(f, "%.3lf %3.lf%s", sp->getX(i), sp->getY(i), i < 3 ? " " : "");
-      fprintf(f, "</rect>");
+  	  w->printf("%.3lf %3.lf%s", xs[i], ys[i], i < 3 ? " " : "");
+      w->put("</rect>");
 #endif
       return;
     }
   } else if(n == 2) {
       // a line
-    double x0 = sp->getX(0);
-    double x1 = sp->getX(1);
-    double y0 = sp->getY(0);
-    double y1 = sp->getY(1);
-    fprintf(f, "%s<line bbox=\"%.3lf,%.3lf,%.3lf,%.3lf\" ", 
-                      indent ? "\n   " : "",
-                x0, y0, x1, y1);    
+    double x0 = xs[0];
+    double x1 = xs[1];
+    double y0 = ys[0];
+    double y1 = ys[1];
+    if(indent)
+        w->put("\n   ");
+    w->put("<line bbox=\"");
+    putBBox(w, x0, y0, x1, y1, params->coordPrecision);
+    w->put("\" ");
 
-    if(info)
-        info->dumpAsXMLAttrs(f);
+    if(style)
+        paths->dumpStyleAsXMLAttrs(w, style, params->coordPrecision);
 
-    fprintf(f, " />\n");
+    w->put(" />\n");
 
     return;
   }
 #if 0
    else  {
 //      fprintf(stderr, "forgotten case for GfxSubpath numPoints = %d\n", n);
-      fprintf(f, "<path numPoints=\"%d\"", n);
+      w->printf("<path numPoints=\"%d\"", n);
       for(int i = 0; i < n; i++)
-          fprintf(f, " x%d=\"%.3lf\" y%d=\"%.3lf\"", i, sp->getX(i), i, sp->getY(i));
-      fputs(" />", f);
+          w->printf(" x%d=\"%.3lf\" y%d=\"%.3lf\"", i, xs[i], i, ys[i]);
+      w->put(" />");
 
   }
 #endif
 
-  fprintf(f, "\n   <coords numPoints=\"%d\" ", n);
-  if(info)
-      info->dumpAsXMLAttrs(f);
-  fprintf(f, ">\n");
+  w->put("\n   <coords numPoints=\"");
+  w->putInt(n);
+  w->put("\" ");
+  if(style)
+      paths->dumpStyleAsXMLAttrs(w, style, params->coordPrecision);
+  w->put(">\n");
   
-  for(int i = 0; i < n ; i++) 
-    fprintf(f, "\n      <coord>%0.3lf %0.3lf</coord>", sp->getX(i),  sp->getY(i));
-  fprintf(f, "\n   </coords>");
+  for(int i = 0; i < n ; i++) {
+    w->put("\n      <coord>");
+    w->putDouble(xs[i], params->coordPrecision);
+    w->put(' ');
+    w->putDouble(ys[i], params->coordPrecision);
+    w->put("</coord>");
+  }
+  w->put("\n   </coords>");
+}
+
+
+//------------------------------------------------------------------------
+// -binary output
+//------------------------------------------------------------------------
+
+// Add <s> to the string table <tab>; returns its offset.
+static unsigned int addBinString(GString *tab, const char *s) {
+  unsigned int off;
+
+  off = (unsigned int)tab->getLength();
+  tab->append(s);
+  tab->append('\0');
+  return off;
+}
+
+// Pad a column of <n> bytes to a multiple of 8.
+static void padBinColumn(HtmlWriter *w, unsigned int n) {
+  if (n & 7) {
+    w->putZeros(8 - (n & 7));
+  }
+}
+
+void HtmlPage::dumpAsBinary(HtmlWriter *w, int page) {
+  GString *tab, *name;
+  HtmlString *str;
+  HtmlFont *font;
+  HtmlPathStyle *style;
+  HtmlLink *link;
+  Image *img;
+  unsigned int colOff[htmlBinNumColumns], colSize[htmlBinNumColumns];
+  unsigned int *fontFamily, *fontName, *textOff, *textLen, *imgFile, *linkDest;
+  unsigned int off;
+  char buf[8];
+  int nFonts, nTexts, nPaths, nSubs, nPoints, nStyles, nDashes;
+  int nImages, nLinks;
+  int i, j, k, n;
+
+  nFonts = fonts->size() - fontsPageMarker;
+  nTexts = 0;
+  for (i = 0; i < nStrs; ++i) {
+    if (strs[i]->htext) {
+      ++nTexts;
+    }
+  }
+  nPaths = paths->getNumPaths();
+  nSubs = paths->getNumAllSubpaths();
+  nPoints = paths->getNumAllPoints();
+  nStyles = paths->getNumStyles();
+  nDashes = paths->getNumDashes();
+  nImages = images.getLength();
+  nLinks = links->getNumLinks();
+
+  // string table
+  tab = new GString();
+  fontFamily = (unsigned int *)gmallocn(nFonts + 1, sizeof(unsigned int));
+  fontName = (unsigned int *)gmallocn(nFonts + 1, sizeof(unsigned int));
+  for (i = 0; i < nFonts; ++i) {
+    font = fonts->Get(fontsPageMarker + i);
+    name = font->getFontName();
+    fontFamily[i] = addBinString(tab, name->getCString());
+    delete name;
+    name = font->getFullName();
+    fontName[i] = addBinString(tab, name->getCString());
+    delete name;
+  }
+  textOff = (unsigned int *)gmallocn(nTexts + 1, sizeof(unsigned int));
+  textLen = (unsigned int *)gmallocn(nTexts + 1, sizeof(unsigned int));
+  for (i = k = 0; i < nStrs; ++i) {
+    str = strs[i];
+    if (!str->htext) {
+      continue;
+    }
+    textOff[k] = (unsigned int)tab->getLength();
+    for (j = 0; j < str->len; ++j) {
+      n = mapUTF8(str->text[j], buf, sizeof(buf));
+      tab->append(buf, n);
+    }
+    textLen[k] = (unsigned int)tab->getLength() - textOff[k];
+    tab->append('\0');
+    ++k;
+  }
+  imgFile = (unsigned int *)gmallocn(nImages + 1, sizeof(unsigned int));
+  for (i = 0; i < nImages; ++i) {
+    img = (Image *)images.get(i);
+    imgFile[i] = img->getFilename() ? addBinString(tab, img->getFilename())
+				    : htmlBinNoString;
+  }
+  linkDest = (unsigned int *)gmallocn(nLinks + 1, sizeof(unsigned int));
+  for (i = 0; i < nLinks; ++i) {
+    name = links->getLink(i)->getDest();
+    linkDest[i] = addBinString(tab, name->getCString());
+    delete name;
+  }
+
+  // column layout
+  colSize[htmlBinStrings] = tab->getLength();
+  for (i = htmlBinFontId; i <= htmlBinFontName; ++i) {
+    colSize[i] = 4 * nFonts;
+  }
+  for (i = htmlBinTextXMin; i <= htmlBinTextYMax; ++i) {
+    colSize[i] = 8 * nTexts;
+  }
+  for (i = htmlBinTextFont; i <= htmlBinTextLength; ++i) {
+    colSize[i] = 4 * nTexts;
+  }
+  colSize[htmlBinPathSubpath] = 4 * (nPaths + 1);
+  colSize[htmlBinPathStyle] = 4 * nPaths;
+  colSize[htmlBinSubpathPoint] = 4 * (nSubs + 1);
+  colSize[htmlBinPointX] = colSize[htmlBinPointY] = 8 * nPoints;
+  colSize[htmlBinStyleFill] = colSize[htmlBinStyleStroke] = 12 * nStyles;
+  colSize[htmlBinStyleLineWidth] = 8 * nStyles;
+  colSize[htmlBinStyleDash] = colSize[htmlBinStyleNumDash] = 4 * nStyles;
+  colSize[htmlBinStyleDashStart] = 8 * nStyles;
+  colSize[htmlBinDash] = 8 * nDashes;
+  for (i = htmlBinImageX; i <= htmlBinImageHeight; ++i) {
+    colSize[i] = 4 * nImages;
+  }
+  for (i = htmlBinImageDrawnWidth; i <= htmlBinImageRotation; ++i) {
+    colSize[i] = 8 * nImages;
+  }
+  colSize[htmlBinImageFile] = 4 * nImages;
+  for (i = htmlBinLinkX1; i <= htmlBinLinkY2; ++i) {
+    colSize[i] = 8 * nLinks;
+  }
+  colSize[htmlBinLinkDest] = 4 * nLinks;
+  off = sizeof(HtmlBinPage);
+  for (i = 0; i < htmlBinNumColumns; ++i) {
+    colOff[i] = off;
+    off += (colSize[i] + 7) & ~7u;
+  }
+
+  // header
+  w->putU32(htmlBinPageMagic);
+  w->putU32(off);
+  w->putU32(page);
+  w->putU32(pageWidth);
+  w->putU32(pageHeight);
+  w->putU32(truncated);
+  w->putF64(rotation);
+  w->putU32(tab->getLength());
+  w->putU32(nFonts);
+  w->putU32(nTexts);
+  w->putU32(nPaths);
+  w->putU32(nSubs);
+  w->putU32(nPoints);
+  w->putU32(nStyles);
+  w->putU32(nDashes);
+  w->putU32(nImages);
+  w->putU32(nLinks);
+  for (i = 0; i < htmlBinNumColumns; ++i) {
+    w->putU32(colOff[i]);
+  }
+  if (htmlBinNumColumns & 1) {
+    w->putU32(0);
+  }
+
+  // columns, in enum order
+  w->put(tab->getCString(), tab->getLength());
+  padBinColumn(w, colSize[htmlBinStrings]);
+
+  for (i = 0; i < nFonts; ++i) {
+    w->putU32(fontsPageMarker + i);
+  }
+  padBinColumn(w, colSize[htmlBinFontId]);
+  for (i = 0; i < nFonts; ++i) {
+    w->putU32(fonts->Get(fontsPageMarker + i)->getSize());
+  }
+  padBinColumn(w, colSize[htmlBinFontSize]);
+  for (i = 0; i < nFonts; ++i) {
+    w->putU32(fonts->Get(fontsPageMarker + i)->getColor().getRGB());
+  }
+  padBinColumn(w, colSize[htmlBinFontColor]);
+  for (i = 0; i < nFonts; ++i) {
+    font = fonts->Get(fontsPageMarker + i);
+    w->putU32((font->isItalic() ? htmlBinFontItalic : 0) |
+	      (font->isBold() ? htmlBinFontBold : 0) |
+	      (font->isOblique() ? htmlBinFontOblique : 0));
+  }
+  padBinColumn(w, colSize[htmlBinFontFlags]);
+  for (i = 0; i < nFonts; ++i) {
+    w->putU32(fontFamily[i]);
+  }
+  padBinColumn(w, colSize[htmlBinFontFamily]);
+  for (i = 0; i < nFonts; ++i) {
+    w->putU32(fontName[i]);
+  }
+  padBinColumn(w, colSize[htmlBinFontName]);
+
+  for (k = htmlBinTextXMin; k <= htmlBinTextYMax; ++k) {
+    for (i = 0; i < nStrs; ++i) {
+      str = strs[i];
+      if (str->htext) {
+	w->putF64(k == htmlBinTextXMin ? str->xMin :
+		  k == htmlBinTextYMin ? str->yMin :
+		  k == htmlBinTextXMax ? str->xMax : str->yMax);
+      }
+    }
+  }
+  for (i = 0; i < nStrs; ++i) {
+    if (strs[i]->htext) {
+      w->putU32(strs[i]->fontpos);
+    }
+  }
+  padBinColumn(w, colSize[htmlBinTextFont]);
+  for (i = 0; i < nTexts; ++i) {
+    w->putU32(textOff[i]);
+  }
+  padBinColumn(w, colSize[htmlBinTextString]);
+  for (i = 0; i < nTexts; ++i) {
+    w->putU32(textLen[i]);
+  }
+  padBinColumn(w, colSize[htmlBinTextLength]);
+
+  for (i = 0; i < nPaths; ++i) {
+    w->putU32(paths->getFirstSubpath(i));
+  }
+  w->putU32(nSubs);
+  padBinColumn(w, colSize[htmlBinPathSubpath]);
+  for (i = 0; i < nPaths; ++i) {
+    w->putU32(paths->getStyleIndex(i));
+  }
+  padBinColumn(w, colSize[htmlBinPathStyle]);
+  for (i = 0; i < nSubs; ++i) {
+    w->putU32(paths->getFirstPoint(i));
+  }
+  w->putU32(nPoints);
+  padBinColumn(w, colSize[htmlBinSubpathPoint]);
+  for (i = 0; i < nPoints; ++i) {
+    w->putF64(paths->getX(0)[i]);
+  }
+  for (i = 0; i < nPoints; ++i) {
+    w->putF64(paths->getY(0)[i]);
+  }
+
+  for (i = 0; i < nStyles; ++i) {
+    style = paths->getStyleAt(i);
+    w->putU32(style->fill.r);
+    w->putU32(style->fill.g);
+    w->putU32(style->fill.b);
+  }
+  padBinColumn(w, colSize[htmlBinStyleFill]);
+  for (i = 0; i < nStyles; ++i) {
+    style = paths->getStyleAt(i);
+    w->putU32(style->stroke.r);
+    w->putU32(style->stroke.g);
+    w->putU32(style->stroke.b);
+  }
+  padBinColumn(w, colSize[htmlBinStyleStroke]);
+  for (i = 0; i < nStyles; ++i) {
+    w->putF64(paths->getStyleAt(i)->lineWidth);
+  }
+  for (i = 0; i < nStyles; ++i) {
+    w->putU32(paths->getStyleAt(i)->firstDash);
+  }
+  padBinColumn(w, colSize[htmlBinStyleDash]);
+  for (i = 0; i < nStyles; ++i) {
+    w->putU32(paths->getStyleAt(i)->numDash);
+  }
+  padBinColumn(w, colSize[htmlBinStyleNumDash]);
+  for (i = 0; i < nStyles; ++i) {
+    w->putF64(paths->getStyleAt(i)->dashStart);
+  }
+  for (i = 0; i < nDashes; ++i) {
+    w->putF64(paths->getDashes()[i]);
+  }
+
+  for (k = htmlBinImageX; k <= htmlBinImageHeight; ++k) {
+    for (i = 0; i < nImages; ++i) {
+      img = (Image *)images.get(i);
+      w->putU32(k == htmlBinImageX ? img->x :
+		k == htmlBinImageY ? img->y :
+		k == htmlBinImageWidth ? img->width : img->height);
+    }
+    padBinColumn(w, colSize[k]);
+  }
+  for (k = htmlBinImageDrawnWidth; k <= htmlBinImageRotation; ++k) {
+    for (i = 0; i < nImages; ++i) {
+      img = (Image *)images.get(i);
+      w->putF64(k == htmlBinImageDrawnWidth ? img->drawnWidth :
+		k == htmlBinImageDrawnHeight ? fabs(img->drawnHeight) :
+		toDegrees(img->rotation));
+    }
+  }
+  for (i = 0; i < nImages; ++i) {
+    w->putU32(imgFile[i]);
+  }
+  padBinColumn(w, colSize[htmlBinImageFile]);
+
+  for (k = htmlBinLinkX1; k <= htmlBinLinkY2; ++k) {
+    for (i = 0; i < nLinks; ++i) {
+      link = links->getLink(i);
+      w->putF64(k == htmlBinLinkX1 ? link->getX1() :
+		k == htmlBinLinkY1 ? link->getY1() :
+		k == htmlBinLinkX2 ? link->getX2() : link->getY2());
+    }
+  }
+  for (i = 0; i < nLinks; ++i) {
+    w->putU32(linkDest[i]);
+  }
+  padBinColumn(w, colSize[htmlBinLinkDest]);
+
+  gfree(fontFamily);
+  gfree(fontName);
+  gfree(textOff);
+  gfree(textLen);
+  gfree(imgFile);
+  gfree(linkDest);
+  delete tab;
 }
 
 
+//------------------------------------------------------------------------
+// -jsonl output
+//------------------------------------------------------------------------
+
+// Write <n> bytes of <s> as a JSON string.  If <utf8> is false, bytes
+// above 0x7f are taken as Latin-1 (font names come straight from the
+// PDF file).
+static void putJSONString(HtmlWriter *w, const char *s, int n, GBool utf8) {
+  static const char hex[] = "0123456789abcdef";
+  char esc[6] = { '\\', 'u', '0', '0', 0, 0 };
+  unsigned char c;
+  int i, start;
+
+  w->put('"');
+  start = 0;
+  for (i = 0; i < n; ++i) {
+    c = (unsigned char)s[i];
+    if (c >= 0x20 && c != '"' && c != '\\' && (utf8 || c < 0x80)) {
+      continue;
+    }
+    w->put(s + start, i - start);
+    start = i + 1;
+    if (c == '"' || c == '\\') {
+      w->put('\\');
+      w->put((char)c);
+    } else if (c == '\n') {
+      w->put("\\n", 2);
+    } else if (c < 0x20) {
+      esc[4] = hex[c >> 4];
+      esc[5] = hex[c & 15];
+      w->put(esc, 6);
+    } else {
+      // Latin-1 to UTF-8
+      w->put((char)(0xc0 | (c >> 6)));
+      w->put((char)(0x80 | (c & 0x3f)));
+    }
+  }
+  w->put(s + start, n - start);
+  w->put('"');
+}
+
+static void putJSONString(HtmlWriter *w, GString *s, GBool utf8) {
+  putJSONString(w, s->getCString(), s->getLength(), utf8);
+}
+
+static void putJSONColor(HtmlWriter *w, GfxRGB *rgb) {
+  w->put('[');
+  w->putInt(rgb->r);
+  w->put(',');
+  w->putInt(rgb->g);
+  w->put(',');
+  w->putInt(rgb->b);
+  w->put(']');
+}
+
+// One line per page: {"page":..., "fonts":[...], "texts":[...],
+// "links":[...], "images":[...], "styles":[...], "paths":[...]}.  Unlike
+// the XML output, each line lists all the fonts its texts use, so that
+// it can be read on its own.
+void HtmlPage::dumpAsJSON(HtmlWriter *w, int page) {
+  GString *tmp;
+  HtmlString *str;
+  HtmlFont *font;
+  HtmlPathStyle *style;
+  HtmlLink *link;
+  Image *img;
+  double *xs, *ys;
+  char *used;
+  char buf[8];
+  int prec, first, sub, nSubs, i, j, k, n;
+
+  prec = params->coordPrecision;
+
+  w->put("{\"page\":");
+  w->putInt(page);
+  w->put(",\"width\":");
+  w->putInt(pageWidth);
+  w->put(",\"height\":");
+  w->putInt(pageHeight);
+  w->put(",\"rotation\":");
+  w->putDouble(rotation, 6);
+  if (truncated != htmlNotTruncated) {
+    w->put(",\"truncated\":\"");
+    w->put(truncationNames[truncated]);
+    w->put('"');
+  }
+
+  // fonts used on this page
+  used = (char *)gmalloc(fonts->size() + 1);
+  memset(used, 0, fonts->size() + 1);
+  for (i = 0; i < nStrs; ++i) {
+    if (strs[i]->htext && strs[i]->fontpos >= 0) {
+      used[strs[i]->fontpos] = 1;
+    }
+  }
+  w->put(",\"fonts\":[");
+  first = 1;
+  for (i = 0; i < fonts->size(); ++i) {
+    if (!used[i]) {
+      continue;
+    }
+    font = fonts->Get(i);
+    if (!first) {
+      w->put(',');
+    }
+    first = 0;
+    w->put("{\"id\":");
+    w->putInt(i);
+    w->put(",\"size\":");
+    w->putInt(font->getSize());
+    w->put(",\"family\":");
+    tmp = font->getFontName();
+    putJSONString(w, tmp, gFalse);
+    delete tmp;
+    w->put(",\"color\":");
+    tmp = font->getColor().toString();
+    putJSONString(w, tmp, gFalse);
+    delete tmp;
+    w->put(font->isItalic() ? ",\"italic\":true" : ",\"italic\":false");
+    w->put(font->isBold() ? ",\"bold\":true" : ",\"bold\":false");
+    w->put(font->isOblique() ? ",\"oblique\":true" : ",\"oblique\":false");
+    w->put(",\"name\":");
+    tmp = font->getFullName();
+    putJSONString(w, tmp, gFalse);
+    delete tmp;
+    w->put('}');
+  }
+  w->put(']');
+  gfree(used);
+
+  // text runs, with the same rounded boxes as the XML output
+  w->put(",\"texts\":[");
+  tmp = new GString();
+  first = 1;
+  for (i = 0; i < nStrs; ++i) {
+    str = strs[i];
+    if (!str->htext) {
+      continue;
+    }
+    if (!first) {
+      w->put(',');
+    }
+    first = 0;
+    w->put("{\"top\":");
+    w->putInt(xoutRound(str->yMin));
+    w->put(",\"left\":");
+    w->putInt(xoutRound(str->xMin));
+    w->put(",\"width\":");
+    w->putInt(xoutRound(str->xMax - str->xMin));
+    w->put(",\"height\":");
+    w->putInt(xoutRound(str->yMax - str->yMin));
+    w->put(",\"font\":");
+    w->putInt(str->fontpos);
+    if (str->rotation_ != 0.0) {
+      w->put(",\"rotation\":");
+      w->putDouble(toDegrees(str->rotation_), 6);
+    }
+    w->put(",\"text\":");
+    tmp->clear();
+    for (j = 0; j < str->len; ++j) {
+      n = mapUTF8(str->text[j], buf, sizeof(buf));
+      tmp->append(buf, n);
+    }
+    putJSONString(w, tmp, gTrue);
+    w->put('}');
+  }
+  delete tmp;
+  w->put(']');
+
+  w->put(",\"links\":[");
+  for (i = 0; i < links->getNumLinks(); ++i) {
+    link = links->getLink(i);
+    if (i > 0) {
+      w->put(',');
+    }
+    w->put("{\"x1\":");
+    w->putDouble(link->getX1(), prec);
+    w->put(",\"y1\":");
+    w->putDouble(link->getY1(), prec);
+    w->put(",\"x2\":");
+    w->putDouble(link->getX2(), prec);
+    w->put(",\"y2\":");
+    w->putDouble(link->getY2(), prec);
+    w->put(",\"url\":");
+    tmp = link->getDest();
+    putJSONString(w, tmp, gFalse);
+    delete tmp;
+    w->put('}');
+  }
+  w->put(']');
+
+  w->put(",\"images\":[");
+  for (i = 0; i < images.getLength(); ++i) {
+    img = (Image *)images.get(i);
+    if (i > 0) {
+      w->put(',');
+    }
+    w->put("{\"x\":");
+    w->putInt(img->x);
+    w->put(",\"y\":");
+    w->putInt(img->y);
+    w->put(",\"originalWidth\":");
+    w->putInt(img->width);
+    w->put(",\"originalHeight\":");
+    w->putInt(img->height);
+    w->put(",\"width\":");
+    w->putDouble(img->drawnWidth, 6);
+    w->put(",\"height\":");
+    w->putDouble(fabs(img->drawnHeight), 6);
+    w->put(",\"rotation\":");
+    w->putDouble(toDegrees(img->rotation), 6);
+    if (img->getFilters()) {
+      w->put(",\"filters\":");
+      putJSONString(w, img->getFilters(), gFalse);
+    }
+    if (img->getFilename()) {
+      w->put(",\"file\":");
+      putJSONString(w, img->getFilename(), strlen(img->getFilename()),
+		    gFalse);
+    }
+    w->put('}');
+  }
+  w->put(']');
+
+  // paths refer to the page's style table by index
+  w->put(",\"styles\":[");
+  for (i = 0; i < paths->getNumStyles(); ++i) {
+    style = paths->getStyleAt(i);
+    if (i > 0) {
+      w->put(',');
+    }
+    w->put("{\"lineWidth\":");
+    w->putDouble(style->lineWidth, prec);
+    w->put(",\"fill\":");
+    putJSONColor(w, &style->fill);
+    w->put(",\"stroke\":");
+    putJSONColor(w, &style->stroke);
+    if (style->numDash > 0) {
+      w->put(",\"dashes\":[");
+      for (j = 0; j < style->numDash; ++j) {
+	if (j > 0) {
+	  w->put(',');
+	}
+	w->putDouble(paths->getDashes()[style->firstDash + j], prec);
+      }
+      w->put("],\"dashStart\":");
+      w->putDouble(style->dashStart, prec);
+    }
+    w->put('}');
+  }
+  w->put(']');
+
+  // each subpath is a flat [x0,y0,x1,y1,...] array
+  w->put(",\"paths\":[");
+  for (i = 0; i < paths->getNumPaths(); ++i) {
+    if (i > 0) {
+      w->put(',');
+    }
+    w->put("{\"style\":");
+    w->putInt(paths->getStyleIndex(i));
+    w->put(",\"subpaths\":[");
+    sub = paths->getFirstSubpath(i);
+    nSubs = paths->getNumSubpaths(i);
+    for (j = sub; j < sub + nSubs; ++j) {
+      if (j > sub) {
+	w->put(',');
+      }
+      w->put('[');
+      xs = paths->getX(j);
+      ys = paths->getY(j);
+      n = paths->getNumPoints(j);
+      for (k = 0; k < n; ++k) {
+	if (k > 0) {
+	  w->put(',');
+	}
+	w->putDouble(xs[k], prec);
+	w->put(',');
+	w->putDouble(ys[k], prec);
+      }
+      w->put(']');
+    }
+    w->put("]}");
+  }
+  w->put("]}\n");
+}
 
-void HtmlPage::dumpComplex(FILE *file, int page){
+void HtmlPage::dumpComplex(HtmlWriter *file, int page){
   FILE* pageFile;
+  HtmlWriter* w;
   GString* tmp;
   char* htmlEncoding;
 
   if( firstPage == -1 ) firstPage = page; 
   
-  if( !noframes )
+  if( !params->noframes )
   {
       GString* pgNum=GString::fromInt(page);
       tmp = new GString(DocName);
@@ -977,108 +1803,120 @@ void HtmlPage::dumpComplex(FILE *file, int page){
 	  return;
       } 
       delete tmp;
+      w = new HtmlWriter(pageFile);
 
-      fprintf(pageFile,"%s\n<HTML>\n<HEAD>\n<TITLE>Page %d</TITLE>\n\n",
-	      DOCTYPE, page);
+      w->printf("%s\n<HTML>\n<HEAD>\n<TITLE>Page %d</TITLE>\n\n",
+		DOCTYPE, page);
 
       htmlEncoding = HtmlOutputDev::mapEncodingToHtml
-	  (globalParams->getTextEncodingName());
-      fprintf(pageFile, "<META http-equiv=\"Content-Type\" content=\"text/html; charset=%s\">\n", htmlEncoding);
+	  (params->uMap->getEncodingName());
+      w->printf("<META http-equiv=\"Content-Type\" content=\"text/html; charset=%s\">\n", htmlEncoding);
   }
   else 
   {
-      pageFile = file;
-      fprintf(pageFile,"<!-- Page %d -->\n", page);
-      fprintf(pageFile,"<a name=\"%d\"></a>\n", page);
+      w = file;
+      w->printf("<!-- Page %d -->\n", page);
+      w->printf("<a name=\"%d\"></a>\n", page);
   } 
   
-  fprintf(pageFile,"<DIV style=\"position:relative;width:%d;height:%d;\">\n",
-	pageWidth, pageHeight);
+  w->printf("<DIV style=\"position:relative;width:%d;height:%d;\">\n",
+	    pageWidth, pageHeight);
 
   tmp=basename(DocName);
    
-  fputs("<STYLE type=\"text/css\">\n<!--\n",pageFile);
+  w->put("<STYLE type=\"text/css\">\n<!--\n");
   for(int i=fontsPageMarker;i!=fonts->size();i++) {
     GString *fontCSStyle = fonts->CSStyle(i);
-    fprintf(pageFile,"\t%s\n",fontCSStyle->getCString());
+    w->put('\t');
+    w->put(fontCSStyle);
+    w->put('\n');
     delete fontCSStyle;
   }
  
-  fputs("-->\n</STYLE>\n",pageFile);
+  w->put("-->\n</STYLE>\n");
   
-  if( !noframes )
+  if( !params->noframes )
   {  
-      fputs("</HEAD>\n<BODY bgcolor=\"#A0A0A0\" vlink=\"blue\" link=\"blue\">\n",pageFile); 
+      w->put("</HEAD>\n<BODY bgcolor=\"#A0A0A0\" vlink=\"blue\" link=\"blue\">\n"); 
   }
   
-  if( !ignore ) 
+  if( !params->ignore ) 
   {
-    fprintf(pageFile,
-	    "<IMG width=\"%d\" height=\"%d\" src=\"%s%03d.%s\" alt=\"background image\">\n",
-	    pageWidth, pageHeight, tmp->getCString(), 
-		(page-firstPage+1), imgExt->getCString());
+    w->printf("<IMG width=\"%d\" height=\"%d\" src=\"%s%03d.%s\" alt=\"background image\">\n",
+	      pageWidth, pageHeight, tmp->getCString(), 
+	      (page-firstPage+1), imgExt->getCString());
   }
   
   delete tmp;
   
   GString *str, *str1;
-  for(HtmlString *tmp1=yxStrings;tmp1;tmp1=tmp1->yxNext){
+  for(int i = 0; i < nStrs; i++){
+    HtmlString *tmp1 = strs[i];
     if (tmp1->htext){
-      str=new GString(tmp1->htext);
-      fprintf(pageFile,
-	      "<DIV style=\"position:absolute;top:%d;left:%d\">",
-	      xoutRound(tmp1->yMin),
-	      xoutRound(tmp1->xMin));
-      fputs("<nobr>",pageFile); 
+      str=new GString(tmp1->htext, tmp1->hlen);
+      w->put("<DIV style=\"position:absolute;top:");
+      w->putInt(xoutRound(tmp1->yMin));
+      w->put(";left:");
+      w->putInt(xoutRound(tmp1->xMin));
+      w->put("\"><nobr>");
       if (tmp1->fontpos!=-1){
 	str1=fonts->getCSStyle(tmp1->fontpos, str);  
       }
       //printf("%s\n", str1->getCString());
-      fputs(str1->getCString(),pageFile);
+      w->put(str1);
       
       delete str;      
       delete str1;
-      fputs("</nobr></DIV>\n",pageFile);
+      w->put("</nobr></DIV>\n");
     }
   }
 
-  fputs("</DIV>\n", pageFile);
+  w->put("</DIV>\n");
   
-  if( !noframes )
+  if( !params->noframes )
   {
-      fputs("</BODY>\n</HTML>\n",pageFile);
+      w->put("</BODY>\n</HTML>\n");
+      stats.bytes += w->getBytesWritten();
+      delete w;
       fclose(pageFile);
   }
 }
 
 
-void HtmlPage::dump(FILE *f, int pageNum) 
+void HtmlPage::dump(FILE *f, int pageNum, int imgNum) 
 {
-  if (complexMode)
+  // the whole page is collected in the writer and flushed once
+  HtmlWriter w(f);
+
+  stats.bytes = 0;
+
+  if (params->complexMode)
   {
-    if (xml) dumpAsXML(f, pageNum);
-    if (!xml) dumpComplex(f, pageNum);  
+    if (params->binary) dumpAsBinary(&w, pageNum);
+    else if (params->jsonl) dumpAsJSON(&w, pageNum);
+    else if (params->xml) dumpAsXML(&w, pageNum);
+    if (!params->xml) dumpComplex(&w, pageNum);  
   }
   else
   {
-    fprintf(f,"<a name=%d></a>",pageNum);
+    w.put("<a name=");
+    w.putInt(pageNum);
+    w.put("></a>");
     GString* fName=basename(DocName); 
-    for (int i=1;i<HtmlOutputDev::imgNum;i++)
-      fprintf(f,"<IMG src=\"%s-%d_%d.jpg\"/><br/>\n",fName->getCString(),pageNum,i);
-    HtmlOutputDev::imgNum=1;
+    for (int i=1;i<imgNum;i++)
+      w.printf("<IMG src=\"%s-%d_%d.jpg\"/><br/>\n",fName->getCString(),pageNum,i);
     delete fName;
 
-    GString* str;
-    for(HtmlString *tmp=yxStrings;tmp;tmp=tmp->yxNext){
+    for(int i = 0; i < nStrs; i++){
+      HtmlString *tmp = strs[i];
       if (tmp->htext){
-		str=new GString(tmp->htext); 
-		fputs(str->getCString(),f);
-		delete str;      
-		fputs("<br>\n",f);  
+		w.put(tmp->htext, tmp->hlen);
+		w.put("<br>\n");  
       }
     }
-	fputs("<hr>\n",f);  
+	w.put("<hr>\n");  
   }
+  stats.bytes += w.getBytesWritten();
 }
 
 
@@ -1113,31 +1951,28 @@ void clear_##T##_GList(GList *_list, int del)       \
       }                                             \
 }
 
-// instantiate these routines for these two types.
+// instantiate the routine for the image list.
 clearGList(Image)
-clearGList(GfxPath)
-clearGList(PathStateInfo)
 
 
 void HtmlPage::clear() {
-  HtmlString *p1, *p2;
+  HtmlPendingImage *img;
+  int i;
 
   if (curStr) {
     delete curStr;
     curStr = NULL;
   }
-  for (p1 = yxStrings; p1; p1 = p2) {
-    p2 = p1->yxNext;
-    delete p1;
+  for (i = 0; i < nStrs; i++) {
+    delete strs[i];
   }
-  yxStrings = NULL;
-  xyStrings = NULL;
-  yxCur1 = yxCur2 = NULL;
+  nStrs = 0;
+  arena->reset();
 
-  if( !noframes )
+  if( !params->noframes )
   {
       delete fonts;
-      fonts=new HtmlFontAccu();
+      fonts=new HtmlFontAccu(params->xml);
       fontsPageMarker = 0;
   }
   else
@@ -1151,9 +1986,210 @@ void HtmlPage::clear() {
 // try to figure out why / if delete the images causes a seg fault
 // Seems to work now that we go from the end of the list to the start.
    clear_Image_GList(&images, 1);
-   clear_PathStateInfo_GList(&pathsInfo, 1);
-   clear_GfxPath_GList(&paths, 1);
+   // the files of a page that was never written
+   for (i = 0; i < pendingImages->getLength(); ++i) {
+     img = (HtmlPendingImage *)pendingImages->get(i);
+     if (img->written)
+       unlink(img->fileName->getCString());
+     delete img->fileName;
+     delete img;
+   }
+   delete pendingImages;
+   pendingImages = new GList();
+   paths->reset();
+   truncated = htmlNotTruncated;
+   stats.clear();
+
+}
+
+void HtmlPage::adopt(HtmlPage *pg) {
+  HtmlString **strsA;
+  HtmlArena *a;
+  HtmlPaths *p;
+  GList *l;
+  int *fontMap;
+  int i, strsSizeA;
+
+  clear();
+
+  // the strings live in pg's arena, so that comes along too
+  a = arena;
+  arena = pg->arena;
+  pg->arena = a;
+
+  fontMap = (int *)gmallocn(pg->fonts->size() > 0 ? pg->fonts->size() : 1,
+			    sizeof(int));
+  for (i = 0; i < pg->fonts->size(); ++i) {
+    fontMap[i] = fonts->AddFont(*pg->fonts->Get(i));
+  }
+  for (i = 0; i < pg->nStrs; i++) {
+    pg->strs[i]->fontpos = fontMap[pg->strs[i]->fontpos];
+  }
+  gfree(fontMap);
+
+  strsA = strs;
+  strsSizeA = strsSize;
+  strs = pg->strs;
+  nStrs = pg->nStrs;
+  strsSize = pg->strsSize;
+  pg->strs = strsA;
+  pg->nStrs = 0;
+  pg->strsSize = strsSizeA;
+
+  delete links;
+  links = pg->links;
+  pg->links = new HtmlLinks();
+
+  for (i = 0; i < pg->images.getLength(); ++i) {
+    images.append(pg->images.get(i));
+  }
+  while (pg->images.getLength() > 0) {
+    pg->images.del(pg->images.getLength() - 1);
+  }
+  l = pendingImages;
+  pendingImages = pg->pendingImages;
+  pg->pendingImages = l;
+  p = paths;
+  paths = pg->paths;
+  pg->paths = p;
 
+  pageWidth = pg->pageWidth;
+  pageHeight = pg->pageHeight;
+  rotation = pg->rotation;
+  truncated = pg->truncated;
+  stats = pg->stats;
+  pageNumber++;
+}
+
+//------------------------------------------------------------------------
+// -stream output
+//------------------------------------------------------------------------
+
+void HtmlPage::startStream(HtmlWriter *w, int page) {
+  streamWriter = w;
+  fontsWritten = fontsPageMarker;
+  if (fontUsed) {
+    memset(fontUsed, 0, fontUsedSize);
+  }
+  dumpPageStartAsXML(w, page, gFalse);
+}
+
+// Write <curStr> and free it.  It is the only string on the page, so
+// the arena is emptied with it.
+void HtmlPage::streamString() {
+  HtmlString *str;
+  int pos, n;
+
+  str = curStr;
+  curStr = NULL;
+  pos = str->fontpos;
+  htmlBuf->clear();
+  HtmlFont::simple(htmlBuf, fonts->Get(pos), str->text, str->len,
+		   params->uMap);
+  str->setHtml(htmlBuf->getCString(), htmlBuf->getLength());
+  if (fontsWritten < fonts->size()) {
+    dumpFontSpecsAsXML(streamWriter, fontsWritten, fonts->size());
+    fontsWritten = fonts->size();
+  }
+  dumpTextAsXML(streamWriter, str);
+  delete str;
+  arena->reset();
+
+  ++stats.strings;
+  if (pos >= 0) {
+    if (pos >= fontUsedSize) {
+      n = fontUsedSize ? 2 * fontUsedSize : 64;
+      while (n <= pos) {
+	n *= 2;
+      }
+      fontUsed = (char *)grealloc(fontUsed, n);
+      memset(fontUsed + fontUsedSize, 0, n - fontUsedSize);
+      fontUsedSize = n;
+    }
+    if (!fontUsed[pos]) {
+      fontUsed[pos] = 1;
+      ++stats.fonts;
+    }
+  }
+}
+
+// Write the paths (and shadings) recorded so far, unless they are to
+// be simplified as a whole at the end of the page.
+void HtmlPage::streamPaths() {
+  if (params->pathTolerance > 0 || params->maxPathPoints > 0) {
+    return;
+  }
+  stats.paths += paths->getNumPaths();
+  stats.points += paths->getNumAllPoints();
+  dumpPathsAsXML(streamWriter);
+  paths->reset();
+}
+
+void HtmlPage::endStream() {
+  HtmlWriter *w;
+
+  w = streamWriter;
+  streamWriter = NULL;
+  dumpFontSpecsAsXML(w, fontsWritten, fonts->size());
+  dumpLinksAsXML(w);
+  dumpImagesAsXML(w);
+  dumpPathsAsXML(w);
+  // what dumpPageStartAsXML would have put in the page tag
+  if (paths->getNumOmitted() > 0 || truncated != htmlNotTruncated) {
+    w->put("<pageinfo");
+    if (paths->getNumOmitted() > 0) {
+      w->put(" pathPoints=\"");
+      w->putInt(paths->getTotalPoints());
+      w->put("\" pathsOmitted=\"");
+      w->putInt(paths->getNumOmitted());
+      w->put('"');
+    }
+    if (truncated != htmlNotTruncated) {
+      w->put(" truncated=\"");
+      w->put(truncationNames[truncated]);
+      w->put('"');
+    }
+    w->put("/>\n");
+  }
+  w->put("</page>\n");
+}
+
+// Memory taken by the content captured so far, for -page-mem: the
+// strings (which live in the arena), the paths and the images.
+size_t HtmlPage::getMemUsed() {
+  return arena->getUsed() +
+         (size_t)strsSize * sizeof(HtmlString *) +
+         paths->getMemUsed() +
+         (size_t)images.getLength() * sizeof(NamedImage);
+}
+
+// Fill in the counts of -stats that are not kept as the page is drawn.
+void HtmlPage::countStats() {
+  char *used;
+  int i, n;
+
+  // with -stream, the strings, images and paths written so far have
+  // been counted already
+  stats.paths += paths->getNumPaths();
+  stats.points += paths->getNumAllPoints();
+  stats.images += images.getLength();
+  stats.links = links->getNumLinks();
+  if (streamWriter) {
+    return;
+  }
+  stats.fonts = 0;
+  if ((n = fonts->size()) > 0) {
+    used = (char *)gmalloc(n);
+    memset(used, 0, n);
+    for (i = 0; i < nStrs; ++i) {
+      if (strs[i]->fontpos >= 0 && strs[i]->fontpos < n &&
+	  !used[strs[i]->fontpos]) {
+	used[strs[i]->fontpos] = 1;
+	++stats.fonts;
+      }
+    }
+    gfree(used);
+  }
 }
 
 void HtmlPage::setDocName(char *fname){
@@ -1236,14 +2272,14 @@ void HtmlOutputDev::doFrame(int firstPage){
   fputs("\n<HTML>",fContentsFrame);
   fputs("\n<HEAD>",fContentsFrame);
   fprintf(fContentsFrame,"\n<TITLE>%s</TITLE>",docTitle->getCString());
-  htmlEncoding = mapEncodingToHtml(globalParams->getTextEncodingName()); // leak GString
+  htmlEncoding = mapEncodingToHtml(params->uMap->getEncodingName());
   fprintf(fContentsFrame, "\n<META http-equiv=\"Content-Type\" content=\"text/html; charset=%s\">\n", htmlEncoding);
   dumpMetaVars(fContentsFrame, NULL);
   fprintf(fContentsFrame, "</HEAD>\n");
   fputs("<FRAMESET cols=\"100,*\">\n",fContentsFrame);
   fprintf(fContentsFrame,"<FRAME name=\"links\" src=\"%s_ind.html\">\n",fName->getCString());
   fputs("<FRAME name=\"contents\" src=",fContentsFrame); 
-  if (complexMode) 
+  if (params->complexMode) 
       fprintf(fContentsFrame,"\"%s-%d.html\"",fName->getCString(), firstPage);
   else
       fprintf(fContentsFrame,"\"%ss.html\"",fName->getCString());
@@ -1255,17 +2291,23 @@ void HtmlOutputDev::doFrame(int firstPage){
 }
 
 #include <time.h>
-#include <sys/stat.h>
 
-HtmlOutputDev::HtmlOutputDev(char *pdfFileName, char *fileName, char *title, 
+HtmlOutputDev::HtmlOutputDev(HtmlParams *paramsA,
+	char *pdfFileName, double pdfFileSize, char *fileName, char *title, 
 	char *author, char *keywords, char *subject, char *date,
 	char *extension,
         GBool rawOrder, int firstPage, GBool outline, Dict *info) 
 {
   char *htmlEncoding;
   
+  params = paramsA;
+  worker = gFalse;
+  donePage = NULL;
+  streamWriter = NULL;
+  imgExt = new GString(extension);
   filename(fileName);
   fContentsFrame = NULL;
+  page = NULL;
   docTitle = new GString(title);
   pages = NULL;
   dumpJPEG=gTrue;
@@ -1278,7 +2320,7 @@ HtmlOutputDev::HtmlOutputDev(char *pdfFileName, char *fileName, char *title,
   //pageNum=firstPage;
   // open file
   needClose = gFalse;
-  pages = new HtmlPage(rawOrder, extension);
+  pages = new HtmlPage(params, rawOrder, extension);
   
   glMetaVars = new GList();
   glMetaVars->append(new HtmlMetaVar("generator", "pdftohtml 0.40"));  
@@ -1292,10 +2334,13 @@ HtmlOutputDev::HtmlOutputDev(char *pdfFileName, char *fileName, char *title,
   maxPageHeight = 0;
 
   pages->setDocName(fileName);
+  // background images are numbered from the first page, even if the
+  // output carries on after a checkpoint
+  pages->firstPage = firstPage;
   Docname=new GString (fileName);
 
   // for non-xml output (complex or simple) with frames generate the left frame
-  if(!xml && !noframes)
+  if(!params->xml && !params->noframes)
   {
      GString* left=new GString(fileName);
      left->append("_ind.html");
@@ -1315,11 +2360,11 @@ HtmlOutputDev::HtmlOutputDev(char *pdfFileName, char *fileName, char *title,
   	if (doOutline)
 	{
 		GString *str = basename(Docname);
-		fprintf(fContentsFrame, "<a href=\"%s%s\" target=\"contents\">Outline</a><br>", str->getCString(), complexMode ? "-outline.html" : "s.html#outline");
+		fprintf(fContentsFrame, "<a href=\"%s%s\" target=\"contents\">Outline</a><br>", str->getCString(), params->complexMode ? "-outline.html" : "s.html#outline");
 		delete str;
 	}
   	
-	if (!complexMode)
+	if (!params->complexMode)
 	{	/* not in complex mode */
 		
        GString* right=new GString(fileName);
@@ -1330,37 +2375,69 @@ HtmlOutputDev::HtmlOutputDev(char *pdfFileName, char *fileName, char *title,
         delete right;
 		return;
        }
+       needClose = gTrue;
        delete right;
        fputs(DOCTYPE, page);
        fputs("<HTML>\n<HEAD>\n<TITLE></TITLE>\n</HEAD>\n<BODY>\n",page);
      }
   }
 
-  if (noframes) {
-    if (stout) page=stdout;
+  if (params->noframes) {
+    GBool resumed = gFalse;
+    if (params->stout) page=stdout;
+    else if (params->outFile) page=params->outFile;
     else {
       GString* right=new GString(fileName);
-      if (!xml) right->append(".html");
-      if (xml) right->append(".xml");
-      if (!(page=fopen(right->getCString(),"w"))){
-	delete right;
+      if (!params->xml) right->append(".html");
+      else if (params->binary) right->append(".bin");
+      else if (params->jsonl) right->append(".jsonl");
+      else right->append(".xml");
+      // carry on after the pages of an earlier, unfinished run
+      if (params->ckpt && params->ckpt->resume(right))
+	resumed = gTrue;
+      if (!(page=fopen(right->getCString(),
+		       resumed ? (params->binary ? "ab" : "a")
+			       : (params->binary ? "wb" : "w")))){
 	error(errIO, 0, "Couldn't open html file '%s'", right->getCString());
+	delete right;
 	return;
       }  
+      needClose = gTrue;
       delete right;
     }
-
-    GString *tmp = globalParams->getTextEncodingName();
-    htmlEncoding = mapEncodingToHtml(tmp); 
-    delete tmp;
-
-    if (xml) 
+
+    htmlEncoding = mapEncodingToHtml(params->uMap->getEncodingName());
+
+    if (resumed)
+    {
+      // the header is there; later pages refer to the fonts declared
+      // so far by number
+      for (int i = 0; i < params->ckpt->getNumFonts(); ++i)
+	pages->fonts->AddFont(*params->ckpt->getFont(i));
+      imgNum = params->ckpt->getImgNum();
+      // progress goes to stderr, so it can't end up in the output
+      if (!params->quiet)
+	fprintf(stderr, "Resuming after page %d\n",
+		params->ckpt->getLastPage());
+    }
+    else if (params->jsonl)
+    {
+      // no header: every line stands on its own
+    }
+    else if (params->binary)
+    {
+      HtmlWriter w(page);
+      w.put(htmlBinMagic, 8);
+      w.putU32(htmlBinVersion);
+      w.putU32(sizeof(HtmlBinFileHeader));
+    }
+    else if (params->xml) 
     {
       fprintf(page, "<?xml version=\"1.0\" encoding=\"%s\"?>\n", htmlEncoding);
       fputs("<!DOCTYPE pdf2xml SYSTEM \"pdf2xml.dtd\">\n\n", page);
       fputs("<pdf2xml>\n",page);
       fputs("  <docinfo>\n", page);
-      if(filename()) {
+      if(pdfFileName) {
           fprintf(page, "    <filename>");
           writeURL(pdfFileName, page);// %s</filename>\n", pdfFileName);
           fprintf(page, "    </filename>");
@@ -1370,9 +2447,8 @@ HtmlOutputDev::HtmlOutputDev(char *pdfFileName, char *fileName, char *title,
       str[strlen(str)-1] = '\0';
       fprintf(page, "     <date>%s</date>\n", str);
 
-      struct stat st; 
-      if(stat(pdfFileName, &st) == 0)
-          fprintf(page, "     <filesize>%lld</filesize>\n",  st.st_size);
+      if (pdfFileSize >= 0)
+          fprintf(page, "     <filesize>%.0f</filesize>\n", pdfFileSize);
 
       dumpMetaVars(page, info);
       fputs("  </docinfo>\n", page);
@@ -1388,10 +2464,38 @@ HtmlOutputDev::HtmlOutputDev(char *pdfFileName, char *fileName, char *title,
       fprintf(page,"</HEAD>\n");
       fprintf(page,"<BODY bgcolor=\"#A0A0A0\" vlink=\"blue\" link=\"blue\">\n");
     }
+    if (params->ckpt && !resumed)
+      params->ckpt->headerDone(page);
   }
   ok = gTrue; 
 }
 
+HtmlOutputDev::HtmlOutputDev(HtmlParams *paramsA, char *fileName,
+			     char *extension, GBool rawOrder)
+{
+  params = paramsA;
+  worker = gTrue;
+  donePage = NULL;
+  streamWriter = NULL;
+  imgExt = new GString(extension);
+  filename(fileName);
+  fContentsFrame = NULL;
+  page = NULL;
+  docTitle = new GString(fileName);
+  dumpJPEG = gTrue;
+  this->rawOrder = rawOrder;
+  doOutline = gFalse;
+  imgNum = 1;
+  needClose = gFalse;
+  glMetaVars = new GList();
+  maxPageWidth = 0;
+  maxPageHeight = 0;
+  pages = new HtmlPage(params, rawOrder, extension);
+  pages->setDocName(fileName);
+  Docname = new GString(fileName);
+  ok = gTrue;
+}
+
 HtmlOutputDev::~HtmlOutputDev() {
   /*if (mode&&!xml){
     int h=xoutRound(pages->pageHeight/scale);
@@ -1401,25 +2505,33 @@ HtmlOutputDev::~HtmlOutputDev() {
     fclose(tin);
     }*/
 
-    HtmlFont::clear(); 
-    
     delete Docname;
     delete docTitle;
+    delete imgExt;
 
     deleteGList(glMetaVars, HtmlMetaVar);
 
+    if (donePage)
+      delete donePage;
+
+    // worker devices never open any files
+    if (!worker) {
     if (fContentsFrame){
       fputs("</BODY>\n</HTML>\n",fContentsFrame);  
       fclose(fContentsFrame);
     }
-    if (xml) {
+    if (params->binary || params->jsonl) {
+    } else if (params->xml) {
       fputs("</pdf2xml>\n",page);  
-      fclose(page);
     } else
-    if ( !complexMode || xml || noframes )
+    if ( !params->complexMode || params->xml || params->noframes )
     { 
       fputs("</BODY>\n</HTML>\n",page);  
+    }
+    if (needClose)
       fclose(page);
+    else if (page)
+      fflush(page);
     }
     if (pages)
       delete pages;
@@ -1446,44 +2558,169 @@ void HtmlOutputDev::startPage(int pageNum, GfxState *state) {
   }*/
 
   this->pageNum = pageNum;
-  GString *str=basename(Docname);
   pages->clear(); 
-  if(!noframes)
+  if (params->stats)
+    stopwatch.lap(&pages->stats, htmlPhaseParse);
+  writeFrameEntry(pageNum);
+
+  pages->pageWidth=static_cast<int>(state->getPageWidth());
+  pages->pageHeight=static_cast<int>(state->getPageHeight());
+  pages->rotation = state->getRotate();
+  pages->pageNumber++;
+
+  if (params->stream && !worker) {
+    streamWriter = new HtmlWriter(page);
+    pages->startStream(streamWriter, pageNum);
+  }
+} 
+
+void HtmlOutputDev::writeFrameEntry(int pageNumA) {
+  if(!params->noframes)
   {
     if (fContentsFrame)
 	{
-      if (complexMode)
-		fprintf(fContentsFrame,"<a href=\"%s-%d.html\"",str->getCString(),pageNum);
+      GString *str=basename(Docname);
+      if (params->complexMode)
+		fprintf(fContentsFrame,"<a href=\"%s-%d.html\"",str->getCString(),pageNumA);
       else 
-		fprintf(fContentsFrame,"<a href=\"%ss.html#%d\"",str->getCString(),pageNum);
-      fprintf(fContentsFrame," target=\"contents\" >Page %d</a><br>\n",pageNum);
+		fprintf(fContentsFrame,"<a href=\"%ss.html#%d\"",str->getCString(),pageNumA);
+      fprintf(fContentsFrame," target=\"contents\" >Page %d</a><br>\n",pageNumA);
+      delete str;
     }
   }
+}
 
-  pages->pageWidth=static_cast<int>(state->getPageWidth());
-  pages->pageHeight=static_cast<int>(state->getPageHeight());
-  pages->rotation = state->getRotate();
-  pages->pageNumber++;
 
-  delete str;
-} 
+GBool HtmlOutputDev::checkPageSlice(Page *page, double hDPI, double vDPI,
+				    int rotate, GBool useMediaBox, GBool crop,
+				    int sliceX, int sliceY,
+				    int sliceW, int sliceH, GBool printing,
+				    GBool (*abortCheckCbk)(void *data),
+				    void *abortCheckCbkData) {
+  if (params->stats)
+    stopwatch.start();
+  if (params->pageTimeout > 0)
+    pageClock.start();
+  return gTrue;
+}
+
+GBool HtmlOutputDev::abortCheck(void *data) {
+  HtmlOutputDev *out = (HtmlOutputDev *)data;
+  HtmlPage *pg = out->pages;
+  HtmlParams *p = out->params;
 
+  if (pg->truncated != htmlNotTruncated) {
+    // keep saying so, to the enclosing content streams too
+    return gTrue;
+  }
+  if (p->pageTimeout > 0 &&
+      out->pageClock.elapsed() * 1000 > p->pageTimeout) {
+    pg->truncated = htmlTruncatedTime;
+    error(errSyntaxError, -1,
+	  "Page {0:d} took more than {1:d} ms; the rest of it is skipped",
+	  out->pageNum, p->pageTimeout);
+    return gTrue;
+  }
+  if (p->pageMem > 0 &&
+      pg->getMemUsed() > (size_t)p->pageMem * 1024 * 1024) {
+    pg->truncated = htmlTruncatedMemory;
+    error(errSyntaxError, -1,
+	  "Page {0:d} took more than {1:d} MB; the rest of it is skipped",
+	  out->pageNum, p->pageMem);
+    return gTrue;
+  }
+  return gFalse;
+}
 
 void HtmlOutputDev::endPage() {
+  if (params->stats) {
+    stopwatch.lap(&pages->stats, htmlPhaseInterpret);
+    pages->countStats();
+  }
+  pages->sortStrings();
   pages->conv();
   //XXX  Do we want to add this back???
-  if(doCoalesce)
+  if(params->doCoalesce)
       pages->coalesce();
-  pages->dump(page, pageNum);
+  if (params->pathTolerance > 0 || params->maxPathPoints > 0)
+    pages->paths->simplify(params->pathTolerance, params->maxPathPoints);
+  if (params->stats)
+    stopwatch.lap(&pages->stats, htmlPhaseLayout);
+
+  if (worker) {
+    // hand the page over; a fresh one collects the next page
+    if (donePage)
+      delete donePage;
+    donePage = pages;
+    pages = new HtmlPage(params, rawOrder, imgExt->getCString());
+    pages->setDocName(Docname->getCString());
+    imgNum = 1;
+    return;
+  }
+  dumpPage();
+}
+
+HtmlPage *HtmlOutputDev::takePage() {
+  HtmlPage *pg;
+
+  pg = donePage;
+  donePage = NULL;
+  return pg;
+}
+
+void HtmlOutputDev::writePage(HtmlPage *pg, int pageNumA) {
+  pageNum = pageNumA;
+  writeFrameEntry(pageNum);
+  pages->adopt(pg);
+  nameImages();
+  dumpPage();
+}
+
+void HtmlOutputDev::displayPagesParallel(PDFDoc *doc, int firstPage,
+					 int lastPage, double hDPI,
+					 double vDPI, int nThreads) {
+  HtmlPageWorkers *workers;
+
+  workers = new HtmlPageWorkers(doc, this, params, Docname, imgExt,
+				rawOrder, nThreads);
+  workers->run(firstPage, lastPage, hDPI, vDPI);
+  delete workers;
+}
+
+void HtmlOutputDev::dumpPage() {
+  if (params->stats)
+    stopwatch.start();
+  if (streamWriter) {
+    // only the rest of the page is left to write
+    pages->endStream();
+    pages->stats.bytes = streamWriter->getBytesWritten();
+    delete streamWriter;
+    streamWriter = NULL;
+  } else {
+    pages->dump(page, pageNum, imgNum);
+  }
+  if (params->jsonl)
+    fflush(page);		// hand each page to the reader right away
+  if (params->stats) {
+    stopwatch.lap(&pages->stats, htmlPhaseDump);
+    params->stats->writePage(pageNum, &pages->stats);
+  }
+  if (!params->complexMode)
+    imgNum = 1;
   
-  // I don't yet know what to do in the case when there are pages of different
-  // sizes and we want complex output: running ghostscript many times 
-  // seems very inefficient. So for now I'll just use last page's size
+  // Only the Ghostscript backgrounds (-dev other than png) need this, and
+  // they are all made at the last page's size; PNG backgrounds are
+  // rendered at each page's own size (HtmlBackground)
   maxPageWidth = pages->pageWidth;
   maxPageHeight = pages->pageHeight;
   
   //if(!noframes&&!xml) fputs("<br>\n", fContentsFrame);
-  if(!stout && !globalParams->getErrQuiet()) printf("Page-%d\n",(pageNum));
+  if (params->ckpt)
+    params->ckpt->pageDone(page, pageNum, imgNum, pages->fonts,
+			   pages->fontsPageMarker);
+  if (params->pageDone)
+    (*params->pageDone)(params->pageDoneData, pageNum);
+  if(!params->stout && !params->quiet) fprintf(stderr,"Page-%d\n",(pageNum));
 }
 
 void HtmlOutputDev::updateFont(GfxState *state) {
@@ -1524,241 +2761,82 @@ void HtmlOutputDev::drawChar(GfxState *state, double x, double y,
 	      double originX, double originY,
 	      CharCode code, int nBytes, Unicode *u, int uLen) 
 {
-  if ( !showHidden && (state->getRender() & 3) == 3) {
+  if ( !params->showHidden && (state->getRender() & 3) == 3) {
     return;
   }
 
   pages->addChar(state, x, y, dx, dy, originX, originY, u, uLen);
 }
 
-void HtmlOutputDev::drawImageMask(GfxState *state, Object *ref, Stream *str,
-			      int width, int height, GBool invert,
-			      GBool inlineImg) {
-
-  int i, j;
-  
-
-  if (ignore || complexMode) {
-    pages->AddImage(state, ref, str, width, height, NULL, NULL, inlineImg);
-    if(!HtmlOutputDev::outputImages)
-      outputImage(state, ref, str);
+// True if <str> is an inline image that gives the length of its data
+// (/L or /Length), in which case Gfx skips the data without decoding
+// it.  Other inline images are decoded and discarded
+// (OutputDev::drawImage), which is the only reliable way to find their
+// end; OutputDev does not read image XObjects.
+static GBool hasInlineLength(Stream *str, GBool inlineImg) {
+  Object obj;
+  GBool ret;
 
-    OutputDev::drawImageMask(state, ref, str, width, height, invert, inlineImg
-#ifndef OLD_VERSION
-                             ,    true // interpolate
-#endif    
-        );
-    return;
+  if (!inlineImg) {
+    return gFalse;
   }
-  
-  FILE *f1;
-  int c;
-  
-  int x0, y0;			// top left corner of image
-  int w0, h0, w1, h1;		// size of image
-  double xt, yt, wt, ht;
-  GBool rotate, xFlip, yFlip;
-  GBool dither;
-  int x, y;
-  int ix, iy;
-  int px1, px2, qx, dx;
-  int py1, py2, qy, dy;
-  Gulong pixel;
-  int nComps, nVals, nBits;
-  double r1, g1, b1;
- 
-  // get image position and size
-  state->transform(0, 0, &xt, &yt);
-  state->transformDelta(1, 1, &wt, &ht);
-  if (wt > 0) {
-    x0 = xoutRound(xt);
-    w0 = xoutRound(wt);
-  } else {
-    x0 = xoutRound(xt + wt);
-    w0 = xoutRound(-wt);
+  ret = str->getDict()->lookup("L", &obj)->isInt();
+  obj.free();
+  if (!ret) {
+    ret = str->getDict()->lookup("Length", &obj)->isInt();
+    obj.free();
   }
-  if (ht > 0) {
-    y0 = xoutRound(yt);
-    h0 = xoutRound(ht);
-  } else {
-    y0 = xoutRound(yt + ht);
-    h0 = xoutRound(-ht);
-  }
-  state->transformDelta(1, 0, &xt, &yt);
-  rotate = fabs(xt) < fabs(yt);
-  if (rotate) {
-    w1 = h0;
-    h1 = w0;
-    xFlip = ht < 0;
-    yFlip = wt > 0;
-  } else {
-    w1 = w0;
-    h1 = h0;
-    xFlip = wt < 0;
-    yFlip = ht > 0;
-  }
-
-  // dump JPEG file
-  if (dumpJPEG  && str->getKind() == strDCT) {
-    GString *fName=new GString(Docname);
-    fName->append("-");
-    GString *pgNum=GString::fromInt(pageNum);
-    GString *imgnum=GString::fromInt(imgNum);
-    // open the image file
-    fName->append(pgNum)->append("_")->append(imgnum)->append(".jpg");
-    ++imgNum;
-    if (!(f1 = fopen(fName->getCString(), "wb"))) {
-      error(errIO, 0, "Couldn't open image file '%s'", fName->getCString());
-      return;
-    }
-
-    // initialize stream
-    str = ((DCTStream *)str)->getRawStream();
-    str->reset();
-
-    // copy the stream
-    while ((c = str->getChar()) != EOF)
-      fputc(c, f1);
+  return ret;
+}
 
-    fclose(f1);
-   
-  if (pgNum) delete pgNum;
-  if (imgnum) delete imgnum;
-  if (fName) delete fName;
-  }
-  else {
-    OutputDev::drawImageMask(state, ref, str, width, height, invert, inlineImg
-#ifndef OLD_VERSION
-                             ,    true // interpolate
-#endif    
-        );
+void HtmlOutputDev::drawImageMask(GfxState *state, Object *ref, Stream *str,
+			      int width, int height, GBool invert,
+			      GBool inlineImg, GBool interpolate) {
+  GString *fName;
+
+  fName = NULL;
+  if (params->ignore || params->complexMode) {
+    if (params->outputImages)
+      fName = outputImage(state, ref, str, width, height, NULL, invert,
+			  inlineImg);
+    pages->AddImage(state, ref, str, width, height, NULL, NULL, inlineImg,
+		    fName ? fName->getCString() : NULL);
+  } else if (dumpJPEG && str->getKind() == strDCT) {
+    fName = writeRawImage(str, inlineImg);
   }
+  if (fName)
+    delete fName;
+
+  if (!hasInlineLength(str, inlineImg))
+    OutputDev::drawImageMask(state, ref, str, width, height, invert,
+			     inlineImg, interpolate);
 }
 
 void HtmlOutputDev::drawImage(GfxState *state, Object *ref, Stream *str,
                               int width, int height, GfxImageColorMap *colorMap,
-                              int *maskColors, GBool inlineImg) 
+                              int *maskColors, GBool inlineImg,
+			      GBool interpolate) 
 {
-
-  int i, j;
-
-  pages->AddImage(state, ref, str, width, height, colorMap, maskColors, inlineImg);
-
-  if(HtmlOutputDev::outputImages)
-     outputImage(state, ref, str);
-
-#if 0
-  char buf[10000];
-  str->getLine(buf, 10000);
-  int vals[11];
-  for(int k = 0; k < 10; k++) {
-      vals[k] = str->getRawChar();
-  }
-#endif
-
-  if (ignore||complexMode) {
-    OutputDev::drawImage(state, ref, str, width, height, colorMap, 
-			 maskColors, inlineImg
-#ifdef OLD_VERSION
-#else                         
-                         , true
-#endif
-        ); 
-    return;
-  }
-
-  FILE *f1;
-  ImageStream *imgStr;
-  Guchar pixBuf[4];
-  GfxColor color;
-  int c;
-  
-  int x0, y0;			// top left corner of image
-  int w0, h0, w1, h1;		// size of image
-  double xt, yt, wt, ht;
-  GBool rotate, xFlip, yFlip;
-  GBool dither;
-  int x, y;
-  int ix, iy;
-  int px1, px2, qx, dx;
-  int py1, py2, qy, dy;
-  Gulong pixel;
-  int nComps, nVals, nBits;
-  double r1, g1, b1;
- 
-  // get image position and size
-  state->transform(0, 0, &xt, &yt);
-  state->transformDelta(1, 1, &wt, &ht);
-  if (wt > 0) {
-    x0 = xoutRound(xt);
-    w0 = xoutRound(wt);
-  } else {
-    x0 = xoutRound(xt + wt);
-    w0 = xoutRound(-wt);
-  }
-  if (ht > 0) {
-    y0 = xoutRound(yt);
-    h0 = xoutRound(ht);
-  } else {
-    y0 = xoutRound(yt + ht);
-    h0 = xoutRound(-ht);
-  }
-  state->transformDelta(1, 0, &xt, &yt);
-  rotate = fabs(xt) < fabs(yt);
-  if (rotate) {
-    w1 = h0;
-    h1 = w0;
-    xFlip = ht < 0;
-    yFlip = wt > 0;
-  } else {
-    w1 = w0;
-    h1 = h0;
-    xFlip = wt < 0;
-    yFlip = ht > 0;
-  }
-
-   
-  /*if( !globalParams->getErrQuiet() )
-    printf("image stream of kind %d\n", str->getKind());*/
-  // dump JPEG file
-  if (dumpJPEG && str->getKind() == strDCT) {
-    GString *fName=new GString(Docname);
-    fName->append("-");
-    GString *pgNum= GString::fromInt(pageNum);
-    GString *imgnum= GString::fromInt(imgNum);  
-    
-    // open the image file
-    fName->append(pgNum)->append("_")->append(imgnum)->append(".jpg");
-    ++imgNum;
-    
-    if (!(f1 = fopen(fName->getCString(), "wb"))) {
-      error(errIO, 0, "Couldn't open image file '%s'", fName->getCString());
-      return;
-    }
-
-    // initialize stream
-    str = ((DCTStream *)str)->getRawStream();
-    str->reset();
-
-    // copy the stream
-    while ((c = str->getChar()) != EOF)
-      fputc(c, f1);
-    
-    fclose(f1);
-  
+  GString *fName;
+
+  // simple mode lists the page's JPEG images (dump), whether or not
+  // -images is given
+  fName = NULL;
+  if (params->outputImages)
+    fName = outputImage(state, ref, str, width, height, colorMap, gFalse,
+			inlineImg);
+  else if (dumpJPEG && !params->ignore && !params->complexMode &&
+	   str->getKind() == strDCT)
+    fName = writeRawImage(str, inlineImg);
+
+  pages->AddImage(state, ref, str, width, height, colorMap, maskColors,
+		  inlineImg, fName ? fName->getCString() : NULL);
+  if (fName)
     delete fName;
-    delete pgNum;
-    delete imgnum;
-  }
-  else {
+
+  if (!hasInlineLength(str, inlineImg))
     OutputDev::drawImage(state, ref, str, width, height, colorMap,
-			 maskColors, inlineImg
-#ifdef OLD_VERSION
-#else                         
-                         , true
-#endif
-        );
-  }
+			 maskColors, inlineImg, interpolate);
 }
 
 
@@ -1813,9 +2891,9 @@ GString* HtmlOutputDev::getLinkDest(Link *link,Catalog* catalog){
 	       	frames		file-4.html	files.html#4
 		noframes	file.html#4	file.html#4
 	       */
-	      if (noframes)
+	      if (params->noframes)
 	      {
-		  if(!xml)
+		  if(!params->xml)
                       file->append(".html#");
                   else {
                       delete file;
@@ -1825,7 +2903,7 @@ GString* HtmlOutputDev::getLinkDest(Link *link,Catalog* catalog){
 	      }
 	      else
 	      {
-	      	if( complexMode ) 
+	      	if( params->complexMode ) 
 		{
 		    file->append("-");
 		    file->append(str);
@@ -1838,7 +2916,7 @@ GString* HtmlOutputDev::getLinkDest(Link *link,Catalog* catalog){
 		}
 	      }
 
-	      if (printCommands) printf(" xlink to page %d \n",page);
+	      if (params->printCommands) printf(" xlink to page %d \n",page);
 	      delete str;
 	      return file;
 	  }
@@ -1862,8 +2940,8 @@ GString* HtmlOutputDev::getLinkDest(Link *link,Catalog* catalog){
 	      if (!(dest->isPageRef()))  page=dest->getPageNum();
 	      delete dest;
 
-	      if (printCommands) printf(" rlink to page %d \n",page);
-	      if (printHtml){
+	      if (params->printCommands) printf(" rlink to page %d \n",page);
+	      if (params->printHtml){
 		  p=file->getCString()+file->getLength()-4;
 		  if (!strcmp(p, ".pdf") || !strcmp(p, ".PDF")){
 		      file->del(file->getLength()-4,4);
@@ -1873,7 +2951,7 @@ GString* HtmlOutputDev::getLinkDest(Link *link,Catalog* catalog){
 		  file->append(GString::fromInt(page));
 	      }
 	  }
-	  if (printCommands) printf("filename %s\n",file->getCString());
+	  if (params->printCommands) printf("filename %s\n",file->getCString());
 	  return file;
 	  }
       case actionURI:
@@ -1887,13 +2965,13 @@ GString* HtmlOutputDev::getLinkDest(Link *link,Catalog* catalog){
 	  {
 	  LinkLaunch *ha=(LinkLaunch *) link->getAction();
 	  GString* file=new GString(ha->getFileName()->getCString());
-	  if (printHtml) { 
+	  if (params->printHtml) { 
 	      p=file->getCString()+file->getLength()-4;
 	      if (!strcmp(p, ".pdf") || !strcmp(p, ".PDF")){
 		  file->del(file->getLength()-4,4);
 		  file->append(".html");
 	      }
-	      if (printCommands) printf("filename %s",file->getCString());
+	      if (params->printCommands) printf("filename %s",file->getCString());
     
 	      return file;      
   
@@ -1951,20 +3029,20 @@ GBool HtmlOutputDev::dumpDocOutline(Catalog* catalog)
 	FILE * output;
 	GBool bClose = gFalse;
 
-	if (!ok || xml)
+	if (!ok || params->xml)
     	return gFalse;
   
 	Object *outlines = catalog->getOutline();
   	if (!outlines->isDict())
     	return gFalse;
   
-	if (!complexMode && !xml)
+	if (!params->complexMode && !params->xml)
   	{
 		output = page;
   	}
-  	else if (complexMode && !xml)
+  	else if (params->complexMode && !params->xml)
 	{
-		if (noframes)
+		if (params->noframes)
 		{
 			output = page; 
 			fputs("<hr>\n", output);
@@ -1983,7 +3061,7 @@ GBool HtmlOutputDev::dumpDocOutline(Catalog* catalog)
 	}
  
   	GBool done = newOutlineLevel(output, outlines, catalog);
-  	if (done && !complexMode)
+  	if (done && !params->complexMode)
     	fputs("<hr>\n", output);
 	
 	if (bClose)
@@ -2044,11 +3122,11 @@ GBool HtmlOutputDev::newOutlineLevel(FILE *output, Object *node, Catalog* catalo
 	   		*/
 	  		linkName=basename(Docname);
 	  		GString *str=GString::fromInt(page);
-	  		if (noframes) {
+	  		if (params->noframes) {
 	    		linkName->append(".html#");
 				linkName->append(str);
 	  		} else {
-    			if( complexMode ) {
+    			if( params->complexMode ) {
 	   		   		linkName->append("-");
 	      			linkName->append(str);
 	      			linkName->append(".html");
@@ -2106,6 +3184,12 @@ void HtmlOutputDev::eoFill(GfxState *state)
     pages->addFill(state); // eoFill(state);
 }
 
+GBool HtmlOutputDev::shadedFill(GfxState *state, GfxShading *shading)
+{
+  pages->addShading(state, shading);
+  return gTrue;
+}
+
 
 
 void
@@ -2171,7 +3255,7 @@ showColorSpaceInfo(GfxColorSpace *colsp, GfxState *state, int isfill = 1)
 
 void HtmlPage::addFill(GfxState *state)
 {
-    if(!HtmlOutputDev::outputPaths)
+    if(!params->outputPaths)
         return;
     
 #if 0
@@ -2183,39 +3267,20 @@ void HtmlPage::addFill(GfxState *state)
   showColorSpaceInfo(colsp, state, 0);
 #endif
 
-  GfxPath *p = state->getPath()->copy();
-  // transform the coordinates to global page coordinates
-  transformPath(p, state);
-  paths.append(p);
-  pathsInfo.append(new PathStateInfo(state));
+  paths->addPath(state);
+  if (streamWriter)
+    streamPaths();
 }
 
-
-void 
-HtmlPage::transformPath(GfxPath *p, GfxState *state)
+void HtmlPage::addShading(GfxState *state, GfxShading *shading)
 {
-    int nsubs = p->getNumSubpaths();
-    for(int j = 0; j < nsubs; j++)
-       transformPath(p->getSubpath(j), state);
+  if(!params->outputPaths)
+    return;
+  paths->addShading(state, shading);
+  if (streamWriter)
+    streamPaths();
 }
 
-void 
-HtmlPage::transformPath(GfxSubpath *sp, GfxState *state)
-{
-    int n = sp->getNumPoints();
-    double x, y, nx, ny;
-    for(int i = 0; i < n ; i++) {
-        x = sp->getX(i);
-        y = sp->getY(i);
-        state->transform(x, y, &nx, &ny);
-#ifdef OLD_VERSION        
-        sp->setX(i, nx);
-        sp->setY(i, ny);
-#else
-#pragma message "Need to fix transformPath() for new version of xpdf"        
-#endif        
-    }
-}
 
 void HtmlOutputDev::stroke(GfxState *state) 
 {
@@ -2225,10 +3290,41 @@ void HtmlOutputDev::stroke(GfxState *state)
 
 
 
+// Names of the filters of image stream <str> (its last filter is the
+// image's), separated by spaces, or NULL if it has none.
+static GString *getImageFilters(Stream *str) {
+  GString *filters;
+  Object obj, obj2;
+  int i;
+
+  filters = NULL;
+  str->getDict()->lookup("Filter", &obj);
+  if (obj.isNull()) {
+    obj.free();
+    str->getDict()->lookup("F", &obj);	// inline image
+  }
+  if (obj.isName()) {
+    filters = new GString(obj.getName());
+  } else if (obj.isArray()) {
+    filters = new GString();
+    for (i = 0; i < obj.arrayGetLength(); ++i) {
+      if (obj.arrayGet(i, &obj2)->isName()) {
+	if (filters->getLength() > 0) {
+	  filters->append(' ');
+	}
+	filters->append(obj2.getName());
+      }
+      obj2.free();
+    }
+  }
+  obj.free();
+  return filters;
+}
+
 void HtmlPage::AddImage(GfxState *state, Object *ref, Stream *str,
                         int width, int height,
                         GfxImageColorMap *colorMap, int *maskColors,
-                        GBool inlineImg)
+                        GBool inlineImg, const char *fileName)
 {
 // Can we get information out of the ref?
 // do we need to transform? Probably.
@@ -2238,7 +3334,7 @@ void HtmlPage::AddImage(GfxState *state, Object *ref, Stream *str,
   state->transform(state->getCurX() + width, state->getCurY() + height, &x1, &y1);
   state->transformDelta(1, 1, &wt, &ht);
   
-#if 1
+#if 0
   printf("AddImage %d, x1 = %lf, y1 = %lf, x = %lf, y = %lf, W = %lf, H = %lf, curx = %lf, cury = %lf, wt = %lf, ht = %lf\n",
          pageNumber, x1, y1, x, y, x1-x, y1-y, state->getCurX(), state->getCurY(), wt, ht);
 #endif  
@@ -2246,64 +3342,98 @@ void HtmlPage::AddImage(GfxState *state, Object *ref, Stream *str,
   double wscale, hscale;
   computeScale(state, &wscale, &hscale);
   /*  */
-  Image *img = new Image(state->getCurX(), state->getCurY() /*x, y */ , width, height, wscale, hscale, computeRotation(state));
+  Image *img;
+  if (fileName)
+    img = new NamedImage(fileName, state->getCurX(), state->getCurY(), width, height, wscale, hscale, computeRotation(state));
+  else
+    img = new Image(state->getCurX(), state->getCurY() /*x, y */ , width, height, wscale, hscale, computeRotation(state));
+  img->setFilters(getImageFilters(str));
+  if (streamWriter) {
+    img->dumpAsXML(streamWriter);
+    delete img;
+    ++stats.images;
+    return;
+  }
   images.append(img);
 }
 
-void Image::dumpAsXML(FILE *f)
+void Image::dumpAsXML(HtmlWriter *w)
 {
-    fprintf(f, "<img ");
-    dumpAsXMLAttributes(f);
-    fprintf(f, "/>\n");
+    w->put("<img ");
+    dumpAsXMLAttributes(w);
+    w->put("/>\n");
 }
 
-void Image::dumpAsXMLAttributes(FILE *f)
+void Image::dumpAsXMLAttributes(HtmlWriter *w)
 {
-    fprintf(f, "x=\"%d\" y=\"%d\" originalWidth=\"%d\" originalHeight=\"%d\" width=\"%lf\" height=\"%lf\"", x, y, width, height, drawnWidth, fabs(drawnHeight));
-    if(rotation != 0.0)
-        fprintf(f, " rotation=\"%lf\"", toDegrees(rotation));
+    w->put("x=\"");
+    w->putInt(x);
+    w->put("\" y=\"");
+    w->putInt(y);
+    w->put("\" originalWidth=\"");
+    w->putInt(width);
+    w->put("\" originalHeight=\"");
+    w->putInt(height);
+    w->put("\" width=\"");
+    w->putDouble(drawnWidth, 6);
+    w->put("\" height=\"");
+    w->putDouble(fabs(drawnHeight), 6);
+    w->put('"');
+    if(rotation != 0.0) {
+        w->put(" rotation=\"");
+        w->putDouble(toDegrees(rotation), 6);
+        w->put('"');
+    }
+    if(filters) {
+        w->put(" filters=\"");
+        w->put(filters);
+        w->put('"');
+    }
 }
 
-void NamedImage::dumpAsXMLAttributes(FILE *f)
+void NamedImage::dumpAsXMLAttributes(HtmlWriter *w)
 {
-    Image::dumpAsXMLAttributes(f);
-    fprintf(f, " filename=\"%s\" ", filename);
+    Image::dumpAsXMLAttributes(w);
+    w->put(" filename=\"");
+    w->put(filename);
+    w->put("\" ");
     if(propsDict && 1) {
         int i, n = propsDict->getLength();
         for(i = 0; i < n ; i++) {
             Object val;
             propsDict->getVal(i, &val);
-            fprintf(f, "%s=\"", propsDict->getKey(i));
+            w->put(propsDict->getKey(i));
+            w->put("=\"");
             switch(val.getType()) {
                 case objBool:
-                   fprintf(f, "%d", val.getBool());
+                   w->putInt(val.getBool());
                    break;
                 case objInt:
-                   fprintf(f, "%d", val.getInt());
+                   w->putInt(val.getInt());
                    break;
                 case objReal:
-                   fprintf(f, "%lf", val.getNum());
+                   w->putDouble(val.getNum(), 6);
                    break;
                 case objName:
-                   fprintf(f, "%s", val.getName());
+                   w->put(val.getName());
                    break;
                 case objCmd:
-                   fprintf(f, "%s", val.getCmd());
+                   w->put(val.getCmd());
                    break;
                 case objString:
-                   fprintf(f, "%s", val.getString()->getCString());
+                   w->put(val.getString()->getCString());
                    break;
                 case objNull:
-                   fprintf(f, "null");
+                   w->put("null");
                    break;
                 case objNone:
-                   fprintf(f, "none");
+                   w->put("none");
                    break;
                 default:
-                   fprintf(f, "???? fix me in HtmlOutputDev.cc");
+                   w->put("???? fix me in HtmlOutputDev.cc");
             }
 
-            fprintf(f, "\" ");
+            w->put("\" ");
         }
     }
 }
@@ -2369,140 +3499,461 @@ void HtmlOutputDev::updateTextPos(GfxState *state)
 
 
 
-PathStateInfo::PathStateInfo(GfxState *state)
-{
-    state->getFillColorSpace()->getRGB(state->getFillColor(), &fill
-#ifdef OLD_VERSION
-#else                                       
-                                       , gfxRenderingIntentAbsoluteColorimetric
-#endif
-        );
-    state->getStrokeColorSpace()->getRGB(state->getStrokeColor(), &stroke
-#ifdef OLD_VERSION
-#else                                       
-                                       , gfxRenderingIntentAbsoluteColorimetric
-#endif
-        );
-    lineWidth = state->getLineWidth();
-
-    double *dashes;
-    int len;
-    state->getLineDash(&dashes, &len, &start);
-    if(len > 0) {
-       dash = (double *) malloc(sizeof(double) * len);
-       memcpy(dash, dashes, sizeof(double)*len);
-       numDash = len;
-    } else {
-       numDash = 0;
-       dash = NULL;
+// Copy <n> bytes of <buf> to <f> (if not NULL) and add them to <hash>
+// and <len>.
+static void putRawBlock(char *buf, int n, FILE *f,
+			unsigned long long *hash, size_t *len) {
+  if (f) {
+    fwrite(buf, 1, n, f);
+  }
+  *hash = HtmlImageCache::hashUpdate(*hash, buf, n);
+  *len += n;
+}
+
+// Copy the encoded data of JPEG, JPEG 2000 or JBIG2 image <str> as it
+// is in the PDF file (without the image filter itself), in large
+// blocks.  If the file is not encrypted, the data comes straight from
+// the file stream's buffer; otherwise it goes through the decryption
+// filter below the image filter.  For JBIG2, the JBIG2Globals segments
+// the embedded stream refers to go first.  The result is a JBIG2
+// stream in the organisation PDF embeds (T.88 annex D.3): segments
+// only, without the file header and the end-of-page and end-of-file
+// segments of a .jb2 file.  With <f> NULL, the data is only hashed.
+static void copyRawImage(Stream *str, FILE *f,
+			 unsigned long long *hash, size_t *len) {
+  char buf[65536];
+  Object parms, obj, globals;
+  Stream *raw;
+  int n;
+
+  *hash = HtmlImageCache::hashStart();
+  *len = 0;
+  if (str->getKind() == strJBIG2) {
+    str->getDict()->lookup("DecodeParms", &parms);
+    if (parms.isArray()) {
+      // the parameters of the last filter, which is JBIG2Decode
+      parms.arrayGet(parms.arrayGetLength() - 1, &obj);
+      parms.free();
+      obj.copy(&parms);
+      obj.free();
     }
-}
+    if (parms.isDict()) {
+      parms.dictLookup("JBIG2Globals", &globals);
+      if (globals.isStream()) {
+	globals.streamReset();
+	while ((n = globals.getStream()->getBlock(buf, sizeof(buf))) > 0) {
+	  putRawBlock(buf, n, f, hash, len);
+	}
+	globals.streamClose();
+      }
+      globals.free();
+    }
+    parms.free();
+  }
+  raw = str->getNextStream();
+  raw->reset();
+  while ((n = raw->getBlock(buf, sizeof(buf))) > 0) {
+    putRawBlock(buf, n, f, hash, len);
+  }
+  raw->close();
+}
+
+// Write a JPEG, JPEG 2000 or JBIG2 image unchanged, as a .jpg, .jp2
+// or (see copyRawImage) .jb2e file.  Returns the file name, or NULL if
+// <str> is of another type.  Simple mode only lists JPEG files.  With
+// an image cache, the data is hashed first, and an image that was
+// already written (in this or an earlier document) is not written
+// again.
+GString *HtmlOutputDev::writeRawImage(Stream *str, GBool inlineImg) {
+  HtmlImageCache *cache;
+  GString *fName;
+  const char *ext;
+  unsigned long long hash;
+  size_t len;
+  FILE *f1;
 
+  switch (str->getKind()) {
+  case strDCT:   ext = ".jpg"; break;
+  case strJPX:   ext = ".jp2"; break;
+  case strJBIG2: ext = ".jb2e"; break;
+  default:       return NULL;
+  }
+  // reading an inline image to its end here would lose Gfx's place in
+  // the content stream
+  if (inlineImg || (!params->complexMode && str->getKind() != strDCT)) {
+    return NULL;
+  }
 
-void 
-PathStateInfo::dumpAsXMLAttrs(FILE *f)
-{
-    fprintf(f, "lineWidth=\"%.3lf\" fill.color=\"%d,%d,%d\"  stroke.color=\"%d,%d,%d\" ", 
-            lineWidth, fill.r, fill.g, fill.b, stroke.r, stroke.g, stroke.b);
+  cache = params->imageCache;
+  if (cache) {
+    copyRawImage(str, NULL, &hash, &len);
+    if ((fName = lookupImageData(hash, len, ext))) {
+      return fName;
+    }
+  }
 
-    if(numDash > 0 && dash) {
-        fprintf(f, "dashes=\"");
-        for(int i = 0; i < numDash; i++) 
-            fprintf(f, "%.3lf%s", dash[i], (i < (numDash - 1)) ? "," : "");
-        fprintf(f, "\" startDash=\"%.3lf\" ", start);
+  if (!(fName = openImageFile(ext, &f1))) {
+    return NULL;
+  }
+  copyRawImage(str, f1, &hash, &len);
+  fclose(f1);
+  imageWritten(fName, cache != NULL, hash, len, ext);
+  return fName;
+}
+
+// Convert the next line of <imgStr> to <row>: gray or RGB bytes, or
+// for a mask (<colorMap> NULL), black where the sample is 0 (1 if
+// <invert>) and white elsewhere.
+static void getPNGRow(ImageStream *imgStr, GfxState *state,
+		      GfxImageColorMap *colorMap, GBool invert,
+		      int width, int nComps, Guchar *row) {
+  Guchar *line;
+  int x;
+
+  if (!(line = imgStr->getLine())) {
+    memset(row, 0, width * nComps);
+  } else if (!colorMap) {
+    for (x = 0; x < width; ++x) {
+      row[x] = (line[x] ^ invert) & 1 ? 0xff : 0x00;
     }
+  } else if (nComps == 1) {
+    colorMap->getGrayByteLine(line, row, width, state->getRenderingIntent());
+  } else {
+    colorMap->getRGBByteLine(line, row, width, state->getRenderingIntent());
+  }
 }
 
+// Decode an image that has no file format of its own and write it as
+// PNG: gray for gray images and masks, RGB otherwise.  Whole lines are
+// converted by GfxImageColorMap::get{Gray,RGB}ByteLine, which have
+// table-driven fast paths for 8-bit and indexed images.  With an image
+// cache, the pixel data is decoded and hashed first, and an image that
+// was already written is neither encoded nor written again.
+GString *HtmlOutputDev::writePNGImage(GfxState *state, Stream *str,
+				      int width, int height,
+				      GfxImageColorMap *colorMap,
+				      GBool invert) {
+  HtmlImageCache *cache;
+  HtmlPNGWriter *png;
+  ImageStream *imgStr;
+  GString *fName;
+  Guchar *row;
+  unsigned long long hash;
+  size_t len;
+  GBool ok;
+  FILE *f1;
+  int nComps, y;
+
+  if (width <= 0 || height <= 0 ||
+      (colorMap && (!colorMap->isOk() || colorMap->getBits() > 8))) {
+    return NULL;
+  }
+  if (!colorMap) {
+    nComps = 1;
+  } else {
+    switch (colorMap->getColorSpace()->getMode()) {
+    case csDeviceGray:
+    case csCalGray:
+      nComps = 1;
+      break;
+    default:
+      nComps = 3;
+      break;
+    }
+  }
+  if (width > INT_MAX / nComps) {
+    return NULL;
+  }
+
+  row = (Guchar *)gmallocn(width, nComps);
+  if (colorMap) {
+    imgStr = new ImageStream(str, width, colorMap->getNumPixelComps(),
+			     colorMap->getBits());
+  } else {
+    imgStr = new ImageStream(str, width, 1, 1);
+  }
 
+  cache = params->imageCache;
+  hash = 0;
+  len = (size_t)width * height * nComps;
+  if (cache) {
+    hash = HtmlImageCache::hashStart();
+    hash = HtmlImageCache::hashUpdate(hash, (char *)&width, sizeof(width));
+    hash = HtmlImageCache::hashUpdate(hash, (char *)&height, sizeof(height));
+    hash = HtmlImageCache::hashUpdate(hash, (char *)&nComps, sizeof(nComps));
+    imgStr->reset();
+    for (y = 0; y < height; ++y) {
+      getPNGRow(imgStr, state, colorMap, invert, width, nComps, row);
+      hash = HtmlImageCache::hashUpdate(hash, (char *)row, width * nComps);
+    }
+    imgStr->close();
+    if ((fName = lookupImageData(hash, len, ".png"))) {
+      delete imgStr;
+      gfree(row);
+      return fName;
+    }
+  }
 
+  if (!(fName = openImageFile(".png", &f1))) {
+    delete imgStr;
+    gfree(row);
+    return NULL;
+  }
 
+  png = new HtmlPNGWriter(f1, width, height, nComps, Z_BEST_SPEED);
+  imgStr->reset();
+  for (y = 0; y < height; ++y) {
+    getPNGRow(imgStr, state, colorMap, invert, width, nComps, row);
+    png->writeRow(row);
+  }
+  imgStr->close();
+  delete imgStr;
+  gfree(row);
+  ok = png->finish();
+  delete png;
+  if (fclose(f1) != 0 || !ok) {
+    error(errIO, -1, "Error writing image file '{0:t}'", fName);
+  }
+  imageWritten(fName, cache != NULL, hash, len, ".png");
+  return fName;
+}
 
-void
-HtmlOutputDev::outputImage(GfxState *state, Object *ref, Stream *str)
+// An image XObject that is drawn again (on this or another page) is
+// looked up by its object number, without reading the stream.  JPEG,
+// JPEG 2000 and JBIG2 images are copied as they are; other images are
+// decoded and written as PNG (not in simple mode, which only lists
+// JPEG files).  <colorMap> is NULL for image masks.
+GString *
+HtmlOutputDev::outputImage(GfxState *state, Object *ref, Stream *str,
+			   int width, int height, GfxImageColorMap *colorMap,
+			   GBool invert, GBool inlineImg)
 {
-  FILE *f1;
-  ImageStream *imgStr;
-  Guchar pixBuf[4];
-  GfxColor color;
-  int c;
-  
-  int x0, y0;			// top left corner of image
-  int w0, h0, w1, h1;		// size of image
-  double xt, yt, wt, ht;
-  GBool rotate, xFlip, yFlip;
-  GBool dither;
-  int x, y;
-  int ix, iy;
-  int px1, px2, qx, dx;
-  int py1, py2, qy, dy;
-  Gulong pixel;
-  int nComps, nVals, nBits;
-  double r1, g1, b1;
- 
-  // get image position and size
-  state->transform(0, 0, &xt, &yt);
-  state->transformDelta(1, 1, &wt, &ht);
-  if (wt > 0) {
-    x0 = xoutRound(xt);
-    w0 = xoutRound(wt);
-  } else {
-    x0 = xoutRound(xt + wt);
-    w0 = xoutRound(-wt);
+  HtmlImageCache *cache;
+  GString *fName;
+
+  cache = params->imageCache;
+  if (cache && ref && ref->isRef() &&
+      (fName = lookupImageRef(ref->getRef()))) {
+    return fName;
   }
-  if (ht > 0) {
-    y0 = xoutRound(yt);
-    h0 = xoutRound(ht);
-  } else {
-    y0 = xoutRound(yt + ht);
-    h0 = xoutRound(-ht);
-  }
-  state->transformDelta(1, 0, &xt, &yt);
-  rotate = fabs(xt) < fabs(yt);
-  if (rotate) {
-    w1 = h0;
-    h1 = w0;
-    xFlip = ht < 0;
-    yFlip = wt > 0;
-  } else {
-    w1 = w0;
-    h1 = h0;
-    xFlip = wt < 0;
-    yFlip = ht > 0;
+  if (inlineImg) {
+    // reading an inline image here would lose Gfx's place in the
+    // content stream
+    return NULL;
   }
+  switch (str->getKind()) {
+  case strDCT:
+  case strJPX:
+  case strJBIG2:
+    fName = writeRawImage(str, inlineImg);
+    break;
+  default:
+    fName = params->complexMode
+              ? writePNGImage(state, str, width, height, colorMap, invert)
+              : (GString *)NULL;
+    break;
+  }
+  if (!fName) {
+    if (!params->quiet)
+      fprintf(stderr, "warning: can't write image (type = %d)\n", str->getKind());
+  } else if (cache && ref && ref->isRef()) {
+    addImageRef(ref->getRef(), fName);
+  }
+  return fName;
+}
 
-   
-  /*if( !globalParams->getErrQuiet() )
-    printf("image stream of kind %d\n", str->getKind());*/
-  // dump JPEG file
-  if (str->getKind() == strDCT) {
-    GString *fName=new GString(Docname);
-    fName->append("-");
-    GString *pgNum= GString::fromInt(pageNum);
-    GString *imgnum= GString::fromInt(imgNum);  
-    
-    // open the image file
-    fName->append(pgNum)->append("_")->append(imgnum)->append(".jpg");
-    ++imgNum;
-    
-    if (!(f1 = fopen(fName->getCString(), "wb"))) {
-      error(errIO, 0, "Couldn't open image file '%s'", fName->getCString());
-      return;
+//------------------------------------------------------------------------
+// image file names
+//------------------------------------------------------------------------
+
+// A worker device can't name image files as it writes them: the
+// numbers go on from page to page, and an image drawn on several pages
+// goes in the file of the first, so both depend on the pages before.
+// It writes the files under temporary names and lists them in
+// HtmlPage::pendingImages; nameImages() names them when the page is
+// written.  Only the main device adds to the image cache, so what a
+// worker finds there comes from earlier pages, and is what the main
+// device would have found.
+
+// The file written for image XObject <ref>, or NULL.
+GString *HtmlOutputDev::lookupImageRef(Ref ref) {
+  HtmlPendingImage *img;
+  GString *fName;
+  int i;
+
+  if ((fName = params->imageCache->lookupRef(ref)) || !worker) {
+    return fName;
+  }
+  for (i = 0; i < pages->pendingImages->getLength(); ++i) {
+    img = (HtmlPendingImage *)pages->pendingImages->get(i);
+    if (img->hasRef && img->ref.num == ref.num && img->ref.gen == ref.gen) {
+      return img->fileName->copy();
     }
+  }
+  return NULL;
+}
 
-    // initialize stream
-    str = ((DCTStream *)str)->getRawStream();
-    str->reset();
+// The file written with contents <hash> and <len> bytes, and extension
+// <ext>, or NULL.
+GString *HtmlOutputDev::lookupImageData(unsigned long long hash, size_t len,
+					const char *ext) {
+  HtmlPendingImage *img;
+  GString *fName;
+  int i;
 
-    // copy the stream
-    while ((c = str->getChar()) != EOF)
-      fputc(c, f1);
-    
-    fclose(f1);
-  
+  if ((fName = params->imageCache->lookupData(hash, len, ext)) || !worker) {
+    return fName;
+  }
+  for (i = 0; i < pages->pendingImages->getLength(); ++i) {
+    img = (HtmlPendingImage *)pages->pendingImages->get(i);
+    if (img->written && img->hasHash && img->hash == hash &&
+	img->len == len && !strcmp(img->ext, ext)) {
+      return img->fileName->copy();
+    }
+  }
+  return NULL;
+}
+
+// Open the file for the next image of the page, with extension <ext>.
+// Returns its name, or NULL if it can't be opened.
+GString *HtmlOutputDev::openImageFile(const char *ext, FILE **f) {
+  GString *fName;
+
+  if (worker) {
+    fName = GString::format("{0:t}-{1:d}_tmp{2:d}{3:s}",
+			    Docname, pageNum, imgNum, ext);
+  } else {
+    fName = GString::format("{0:t}-{1:d}_{2:d}{3:s}",
+			    Docname, pageNum, imgNum, ext);
+  }
+  if (!(*f = fopen(fName->getCString(), "wb"))) {
+    error(errIO, -1, "Couldn't open image file '{0:t}'", fName);
     delete fName;
-    delete pgNum;
-    delete imgnum;
-  } else if( !globalParams->getErrQuiet() )
-      fprintf(stderr, "warning: can't write image (type = %d)\n", str->getKind());
+    return NULL;
+  }
+  ++imgNum;
+  return fName;
+}
+
+// File <fName> has been written, with contents <hash> and <len> (if
+// <hasHash>) and extension <ext>.
+void HtmlOutputDev::imageWritten(GString *fName, GBool hasHash,
+				 unsigned long long hash, size_t len,
+				 const char *ext) {
+  HtmlPendingImage *img;
+
+  if (!worker) {
+    if (hasHash) {
+      params->imageCache->addData(hash, len, ext, fName);
+    }
+    return;
+  }
+  img = new HtmlPendingImage;
+  img->fileName = fName->copy();
+  img->written = gTrue;
+  img->hasRef = gFalse;
+  img->ref.num = img->ref.gen = 0;
+  img->hasHash = hasHash;
+  img->hash = hash;
+  img->len = len;
+  img->ext = ext;
+  pages->pendingImages->append(img);
+}
+
+// Image XObject <ref> is in file <fName>.
+void HtmlOutputDev::addImageRef(Ref ref, GString *fName) {
+  HtmlPendingImage *img;
+  int n;
+
+  if (!worker) {
+    params->imageCache->addRef(ref, fName);
+    return;
+  }
+  n = pages->pendingImages->getLength();
+  if (n > 0) {
+    img = (HtmlPendingImage *)pages->pendingImages->get(n - 1);
+    if (img->written && !img->hasRef && !img->fileName->cmp(fName)) {
+      // the file was just written for it
+      img->hasRef = gTrue;
+      img->ref = ref;
+      return;
+    }
+  }
+  img = new HtmlPendingImage;
+  img->fileName = fName->copy();
+  img->written = gFalse;
+  img->hasRef = gTrue;
+  img->ref = ref;
+  img->hasHash = gFalse;
+  img->hash = 0;
+  img->len = 0;
+  img->ext = NULL;
+  pages->pendingImages->append(img);
+}
+
+// Name the image files of the page a worker device handed over, the
+// way they would have been named had the page been drawn here: a file
+// whose image was written before (on an earlier page, as it turns
+// out) is removed, the others are numbered on.
+void HtmlOutputDev::nameImages() {
+  HtmlImageCache *cache;
+  HtmlPendingImage *img;
+  GHash *names;
+  GString *fName;
+  Image *image;
+  int i;
 
+  cache = params->imageCache;
+  names = new GHash(gTrue);
+  for (i = 0; i < pages->pendingImages->getLength(); ++i) {
+    img = (HtmlPendingImage *)pages->pendingImages->get(i);
+    if (!img->written) {
+      if ((fName = (GString *)names->lookup(img->fileName))) {
+	cache->addRef(img->ref, fName);
+      } else {
+	cache->addRef(img->ref, img->fileName);
+      }
+      continue;
+    }
+    fName = NULL;
+    if (cache && img->hasRef) {
+      fName = cache->lookupRef(img->ref);
+    }
+    if (cache && !fName && img->hasHash) {
+      fName = cache->lookupData(img->hash, img->len, img->ext);
+    }
+    if (fName) {
+      unlink(img->fileName->getCString());
+    } else {
+      fName = GString::format("{0:t}-{1:d}_{2:d}{3:s}",
+			      Docname, pageNum, imgNum, img->ext);
+      if (rename(img->fileName->getCString(), fName->getCString()) != 0) {
+	error(errIO, -1, "Couldn't rename image file '{0:t}'", img->fileName);
+      }
+      ++imgNum;
+      if (img->hasHash) {
+	cache->addData(img->hash, img->len, img->ext, fName);
+      }
+    }
+    if (cache && img->hasRef) {
+      cache->addRef(img->ref, fName);
+    }
+    names->add(img->fileName->copy(), fName);
+  }
+  for (i = 0; i < pages->pendingImages->getLength(); ++i) {
+    img = (HtmlPendingImage *)pages->pendingImages->get(i);
+    delete img->fileName;
+    delete img;
+  }
+  delete pages->pendingImages;
+  pages->pendingImages = new GList();
+
+  for (i = 0; i < pages->images.getLength(); ++i) {
+    image = (Image *)pages->images.get(i);
+    if (image->getFilename() &&
+	(fName = (GString *)names->lookup(image->getFilename()))) {
+      ((NamedImage *)image)->setFilename(fName->getCString());
+    }
+  }
+  deleteGHash(names, GString);
 }
@@ -15,12 +15,18 @@
 #endif
 
 #include <stdio.h>
+#include <string.h>
 #include "gtypes.h"
+#include "GString.h"
 #include "GList.h"
 #include "GfxFont.h"
 #include "OutputDev.h"
 #include "HtmlLinks.h"
 #include "HtmlFonts.h"
+#include "HtmlParams.h"
+#include "HtmlArena.h"
+#include "HtmlPaths.h"
+#include "HtmlStats.h"
 #include "Link.h"
 #include "Catalog.h"
 #include "UnicodeMap.h"
@@ -40,8 +46,11 @@
 
 class GfxState;
 class GString;
+class PDFDoc;
+
+class HtmlWriter;
+struct HtmlBand;
 
-class PathStateInfo;
 //------------------------------------------------------------------------
 // HtmlString
 //------------------------------------------------------------------------
@@ -51,11 +60,16 @@ class PathStateInfo;
 class HtmlString {
 public:
 
-  // Constructor.
-    HtmlString(GfxState *state, double fontSize, double charspace, HtmlFontAccu* fonts, double rotation = 0.0);
+  // Strings are allocated in their page's arena, and so are the text,
+  // xRight and htext arrays.  A string owns nothing else, so deleting
+  // one does nothing: the memory goes when the arena is reset.
+  void *operator new(size_t size, HtmlArena *arena)
+    { return arena->alloc(size); }
+  void operator delete(void *p, HtmlArena *arena) {}
+  void operator delete(void *p) {}
 
-  // Destructor.
-  ~HtmlString();
+  // Constructor.
+    HtmlString(GfxState *state, double fontSize, double charspace, HtmlFontAccu* fonts, HtmlArena *arenaA, double rotation = 0.0);
 
   // Add a character to the string.
   void addChar(GfxState *state, double x, double y,
@@ -67,19 +81,30 @@ public:
   double rotation() { return(rotation_); }
 
 private:
+  // make room for <n> chars in text and xRight
+  void reserve(int n);
+  // make room for <n> bytes in htext
+  void reserveHtml(int n);
+  // set htext to, or add to its end or start, the <n> bytes at <s>
+  void setHtml(const char *s, int n);
+  void appendHtml(const char *s, int n);
+  void appendHtml(const char *s) { appendHtml(s, (int)strlen(s)); }
+  void appendHtml(GString *s) { appendHtml(s->getCString(), s->getLength()); }
+  void insertHtml(GString *s);
+
 // aender die text variable
+  HtmlArena *arena;
   HtmlLink *link;
   double xMin, xMax;		// bounding box x coordinates
   double yMin, yMax;		// bounding box y coordinates
   int col;			// starting column
   Unicode *text;		// the text
   double *xRight;		// right-hand x coord of each char
-  HtmlString *yxNext;		// next string in y-major order
-  HtmlString *xyNext;		// next string in x-major order
   int fontpos;
-  GString* htext;
-  GString* htext2;
-  int strSize;
+  char *htext;			// the text as HTML, set by HtmlPage::conv
+				//   (NUL-terminated, or NULL)
+  int hlen;			// length of htext
+  int hsize;			// size of the htext array
   int len;			// length of text and xRight
   int size;			// size of text and xRight arrays
 #ifdef HAVE_UNICODE_TEXT_DIRECTION
@@ -103,30 +128,50 @@ public:
 Image(int x, int y, int width, int height, double drawnWidth, double drawnHeight,
        double rotation = 0.0) : 
         x(x), y(y), width(width), height(height), 
-	    drawnWidth(drawnWidth), drawnHeight(drawnHeight), rotation(rotation) {
+	    drawnWidth(drawnWidth), drawnHeight(drawnHeight), rotation(rotation),
+	    filters(NULL) {
      }
+     virtual ~Image() { if (filters) delete filters; }
 
-     virtual void dumpAsXML(FILE *f);
+     virtual void dumpAsXML(HtmlWriter *w);
+
+     // file the image was written to, or NULL
+     virtual const char *getFilename() { return NULL; }
+
+     // filter names of the image stream, e.g. "FlateDecode DCTDecode"
+     // (takes ownership)
+     void setFilters(GString *filtersA) { filters = filtersA; }
+     GString *getFilters() { return filters; }
 
 protected:
      int x, y, width, height;
      double drawnWidth, drawnHeight;
      double rotation;
+     GString *filters;
 
-     virtual void dumpAsXMLAttributes(FILE *f);
+     virtual void dumpAsXMLAttributes(HtmlWriter *w);
+
+     friend class HtmlPage;
 };
 
 class NamedImage : public Image {
 public:
-NamedImage(const char *filename, int x, int y, int width, int height, double drawnWidth, double drawnHeight) :  Image(x, y, width, height, drawnWidth, drawnHeight) {  
+NamedImage(const char *filename, int x, int y, int width, int height, double drawnWidth, double drawnHeight,
+	   double rotation = 0.0) :  Image(x, y, width, height, drawnWidth, drawnHeight, rotation) {  
+	this->filename = NULL;
 	setFilename(filename);
+	propsDict = NULL;
      }
+    virtual ~NamedImage() { free(filename); }
 
     void setFilename(const char *name) {
+	free(filename);
 	filename = strdup(name);
     }
 
-    virtual void dumpAsXMLAttributes(FILE *f);
+    virtual void dumpAsXMLAttributes(HtmlWriter *w);
+
+    virtual const char *getFilename() { return filename; }
 
     virtual void setPropsDict(Dict *dict) { propsDict = dict;}
 protected:
@@ -134,12 +179,35 @@ protected:
     Dict *propsDict;
 };
 
+// An image file that a worker device wrote for -images, under a
+// temporary name, or an image XObject it found in such a file.  The
+// main device gives the files their final names when it writes the
+// page (HtmlOutputDev::nameImages), so they are numbered, and found
+// again in the image cache, in page order as without -j.
+struct HtmlPendingImage {
+  GString *fileName;		// temporary name (or, if !written, the
+				//   file the XObject was found in)
+  GBool written;		// file written for this image?
+  GBool hasRef;			// image XObject <ref>
+  Ref ref;
+  GBool hasHash;		// contents, for the image cache
+  unsigned long long hash;
+  size_t len;
+  const char *ext;		// file name extension
+};
+
+// Why a page was cut short (the same values as htmlBinTruncated...).
+enum HtmlTruncation {
+  htmlNotTruncated,
+  htmlTruncatedTime,		// over -page-timeout
+  htmlTruncatedMemory		// over -page-mem
+};
 
 class HtmlPage {
 public:
 
   // Constructor.
-  HtmlPage(GBool rawOrder, char *imgExtVal);
+  HtmlPage(HtmlParams *paramsA, GBool rawOrder, char *imgExtVal);
 
   // Destructor.
   ~HtmlPage();
@@ -156,9 +224,13 @@ public:
   void updateFont(GfxState *state);
   void updateCharSpace(GfxState *state);
 
-  // End the current string, sorting it into the list of strings.
+  // End the current string, adding it to the list of strings.
   void endString();
 
+  // Put the strings in reading (y-major) order, unless rawOrder is
+  // set.  Called once the page is complete.
+  void sortStrings();
+
   // Coalesce strings that look like parts of the same line.
   void coalesce();
 
@@ -174,10 +246,34 @@ public:
     links->AddLink(x);
   }
 
- void dump(FILE *f, int pageNum);
+ // <imgNum> is the number of the next image to be written (simple
+ // mode lists images 1 .. <imgNum>-1 of the page).
+ void dump(FILE *f, int pageNum, int imgNum);
 
   // Clear the page.
   void clear();
+
+  // Clear the page and take over the strings, links, paths and images
+  // of <pg>, which was filled in by another (worker) device.  The fonts
+  // of <pg> are merged into this page's font list and the strings are
+  // renumbered accordingly, so the result dumps exactly as if the page
+  // had been drawn on this page.  <pg> is left empty.
+  void adopt(HtmlPage *pg);
+
+  // Fill in the counts in <stats> that are taken from the finished page.
+  void countStats();
+
+  // Approximate memory taken by the content of the page so far.
+  size_t getMemUsed();
+
+  // -stream: write page <page> to <w> as it is drawn.  Each string is
+  // written (with the specs of fonts not written yet) and freed as soon
+  // as it is ended, in content stream order; images and, unless they
+  // are simplified, paths are written as they are added.
+  void startStream(HtmlWriter *w, int page);
+
+  // Write the rest of the page and stop streaming.
+  void endStream();
   
   void conv();
 
@@ -185,36 +281,53 @@ public:
 
 
   void addFill(GfxState *state);
-  void dumpAsXML(FILE *f, GfxSubpath *sp, PathStateInfo *, bool indent = false);
-  void dumpImagesAsXML(FILE* f);
-
-  void transformPath(GfxSubpath *sp, GfxState *state);
-  void transformPath(GfxPath *p, GfxState *state);
+  void addShading(GfxState *state, GfxShading *shading);
+  // Write one subpath: a <rect>, <line> or <coords> element.  <style>
+  // is NULL for the members of a <paths> group.
+  void dumpAsXML(HtmlWriter *w, double *xs, double *ys, int n,
+		 HtmlPathStyle *style, bool indent = false);
+  void dumpImagesAsXML(HtmlWriter *w);
 
   void AddImage(GfxState *state, Object *ref, Stream *str,
 		int width, int height, 
 		GfxImageColorMap *colorMap, int *maskColors,
-		GBool inlineImg);
+		GBool inlineImg, const char *fileName = NULL);
 
   void eoFill(GfxState *state);
 
 
 private:
   HtmlFont* getFont(HtmlString *hStr) { return fonts->Get(hStr->fontpos); }
+  static GBool precedes(HtmlString *str1, HtmlString *str2);
+  HtmlBand *makeBands(int *next, int *nBands);
+  GBool canMerge(HtmlString *str1, HtmlString *str2);
+  void merge(HtmlString *str1, HtmlString *str2);
 
+  HtmlParams *params;		// conversion settings
   double fontSize;		// current font size
   GBool rawOrder;		// keep strings in content stream order
   double charspace;
   HtmlString *curStr;		// currently active string
 
-  HtmlString *yxStrings;	// strings in y-major order
-  HtmlString *xyStrings;	// strings in x-major order
-  HtmlString *yxCur1, *yxCur2;	// cursors for yxStrings list
+  HtmlString **strs;		// strings of the page; in y-major order
+				//   once sortStrings() has run
+  int nStrs;			// number of strings
+  int strsSize;			// size of the strs array
+  HtmlArena *arena;		// memory for the strings of this page
+  GString *htmlBuf;		// scratch for the strings' htext
   
   void setDocName(char* fname);
-  void dumpAsXML(FILE* f,int page);
-  void dumpLinksAsXML(FILE* f);
-  void dumpComplex(FILE* f, int page);
+  void dumpAsXML(HtmlWriter *w, int page);
+  void dumpPageStartAsXML(HtmlWriter *w, int page, GBool final);
+  void dumpFontSpecsAsXML(HtmlWriter *w, int first, int last);
+  void dumpTextAsXML(HtmlWriter *w, HtmlString *str);
+  void dumpPathsAsXML(HtmlWriter *w);
+  void streamString();
+  void streamPaths();
+  void dumpAsBinary(HtmlWriter *w, int page);
+  void dumpAsJSON(HtmlWriter *w, int page);
+  void dumpLinksAsXML(HtmlWriter *w);
+  void dumpComplex(HtmlWriter *w, int page);
 
   // marks the position of the fonts that belong to current page (for noframes)
   int fontsPageMarker; 
@@ -225,15 +338,21 @@ private:
   GString *imgExt;
   int pageWidth;
   int pageHeight;
-  static int pgNum;
   int firstPage;                // used to begin the numeration of pages
 
   int pageNumber;
+  GList *pendingImages;		// [HtmlPendingImage] image files of a
+				//   worker device's page, still to be named
 
   double rotation;
-  GList paths;
-  GList pathsInfo;
+  HtmlPaths *paths;		// fills and strokes of this page
   GList images;
+  HtmlPageStats stats;		// for -stats
+  HtmlTruncation truncated;	// why the page was cut short, if it was
+  HtmlWriter *streamWriter;	// -stream: the page being written, or NULL
+  int fontsWritten;		// -stream: fontspecs written so far
+  char *fontUsed;		// -stream: fonts used by the page's
+  int fontUsedSize;		//   strings, for -stats
 
   friend class HtmlOutputDev;
 
@@ -241,30 +360,6 @@ private:
   int debug;
 };
 
-class PathStateInfo {
-public:
-    PathStateInfo(GfxState *);
-    void dumpAsXMLAttrs(FILE *f);
-
-    ~PathStateInfo() {
-	if(dash) { 
-          free(dash);
-	  dash = NULL;
-	}
-    }
-
-protected:
-    GfxRGB fill;
-    GfxRGB stroke;
-    double lineWidth;
-
-
-    double *dash;
-    int numDash;
-    double start;
-};
-
-
 //------------------------------------------------------------------------
 // HtmlMetaVar
 //------------------------------------------------------------------------
@@ -293,8 +388,10 @@ public:
   // text is converted to 7-bit ASCII; otherwise, text is converted to
   // 8-bit ISO Latin-1.  <useASCII7> should also be set for Japanese
   // (EUC-JP) text.  If <rawOrder> is true, the text is kept in content
-  // stream order.
-    HtmlOutputDev(char *pdfFilename, char *fileName, char *title, 
+  // stream order.  The -xml header gives <pdfFilename> (NULL for a
+  // document read from memory) and <pdfFileSize> (unless it is -1).
+    HtmlOutputDev(HtmlParams *paramsA,
+	  char *pdfFilename, double pdfFileSize, char *fileName, char *title, 
 	  char *author,
 	  char *keywords,
 	  char *subject,
@@ -304,6 +401,12 @@ public:
 	  int firstPage = 1,
 	  GBool outline = 0, Dict *info = NULL);
 
+  // Open a worker device.  It writes no files: each page is converted
+  // (and coalesced) as usual, and then handed back by takePage() so
+  // that the main device can write it with writePage().
+  HtmlOutputDev(HtmlParams *paramsA, char *fileName, char *extension,
+		GBool rawOrder);
+
   // Destructor.
   virtual ~HtmlOutputDev();
 
@@ -323,11 +426,29 @@ public:
   // text in Type 3 fonts will be drawn with drawChar/drawString.
   virtual GBool interpretType3Chars() { return gFalse; }
 
-  // Does this device need non-text content?
-  virtual GBool needNonText() { return gTrue /* gFalse */ ; }
+  // Does this device need non-text content?  Only for -images, and
+  // for -paths in the XML output (the HTML output has no paths).
+  // Otherwise Gfx skips patterns and shadings, and the images are
+  // only recorded (needImageInfo), not read.
+  virtual GBool needNonText()
+    { return params->outputImages || (params->xml && params->outputPaths); }
+  virtual GBool needImageInfo() { return gTrue; }
 
   //----- initialization and control
 
+  // Called before the page is set up; starts the -stats timer.
+  virtual GBool checkPageSlice(Page *page, double hDPI, double vDPI,
+			       int rotate, GBool useMediaBox, GBool crop,
+			       int sliceX, int sliceY, int sliceW, int sliceH,
+			       GBool printing,
+			       GBool (*abortCheckCbk)(void *data) = NULL,
+			       void *abortCheckCbkData = NULL);
+
+  // Abort check for Gfx (data is the device): true once the page has
+  // gone over -page-timeout or -page-mem.  What was captured up to
+  // then is written as usual, marked as truncated.
+  static GBool abortCheck(void *data);
+
   // Start a page.
   virtual void startPage(int pageNum, GfxState *state);
 
@@ -352,10 +473,10 @@ public:
   virtual void drawImageMask(GfxState *state, Object *ref, 
 			     Stream *str,
 			     int width, int height, GBool invert,
-			     GBool inlineImg);
+			     GBool inlineImg, GBool interpolate);
   virtual void drawImage(GfxState *state, Object *ref, Stream *str,
 			  int width, int height, GfxImageColorMap *colorMap,
-			 int *maskColors, GBool inlineImg);
+			 int *maskColors, GBool inlineImg, GBool interpolate);
 
   //new feature    
   virtual int DevType() {return 1234;}
@@ -366,6 +487,19 @@ public:
 
   GBool dumpDocOutline(Catalog* catalog);
 
+  // Return the last page finished by a worker device.  The caller
+  // owns the page.
+  HtmlPage *takePage();
+
+  // Write a page finished by a worker device, as if it had been
+  // drawn on this device as page <pageNumA>.
+  void writePage(HtmlPage *pg, int pageNumA);
+
+  // Convert pages <firstPage> .. <lastPage> of <doc> on <nThreads>
+  // worker threads and write them to this device in page order.
+  void displayPagesParallel(PDFDoc *doc, int firstPage, int lastPage,
+			    double hDPI, double vDPI, int nThreads);
+
 
   //  void stroke(GfxState *state);
   void fill(GfxState *state) ;
@@ -375,10 +509,9 @@ public:
 
   void eoFill(GfxState *state);
 
-  // used as a global variable in pdftohtml to control whether we coalesce the strings together across calls.
-  static GBool doCoalesce;
-  static GBool outputPaths;
-  static GBool outputImages;
+  // Record the shading as a single <shading> element, so that Gfx does
+  // not break it up into small fills.
+  GBool shadedFill(GfxState *state, GfxShading *shading);
 
 
   void updateFillColorSpace(GfxState *state);
@@ -387,7 +520,13 @@ public:
   const char *filename() const { return _filename;}
   const char *filename(const char *fn)  { _filename = fn; return _filename;}
 
-  void outputImage(GfxState *state, Object *ref, Stream *str);
+  // Write image <str> (XObject <ref>, if not NULL) to a file for
+  // -images, or find the file it was already written to.  <colorMap>
+  // is NULL for an image mask.  Returns the file name (to be deleted
+  // by the caller), or NULL if it was not written.
+  GString *outputImage(GfxState *state, Object *ref, Stream *str,
+		       int width, int height, GfxImageColorMap *colorMap,
+		       GBool invert, GBool inlineImg);
 
 private:
   // convert encoding into a HTML standard, or encoding->getCString if not
@@ -397,7 +536,21 @@ private:
   void dumpMetaVars(FILE *, Dict *);
   void doFrame(int firstPage);
   GBool newOutlineLevel(FILE *output, Object *node, Catalog* catalog, int level = 1);
-
+  void writeFrameEntry(int pageNumA);
+  void dumpPage();
+  GString *lookupImageRef(Ref ref);
+  GString *lookupImageData(unsigned long long hash, size_t len,
+			   const char *ext);
+  GString *openImageFile(const char *ext, FILE **f);
+  void imageWritten(GString *fName, GBool hasHash, unsigned long long hash,
+		    size_t len, const char *ext);
+  void addImageRef(Ref ref, GString *fName);
+  void nameImages();
+  GString *writeRawImage(Stream *str, GBool inlineImg);
+  GString *writePNGImage(GfxState *state, Stream *str, int width, int height,
+			 GfxImageColorMap *colorMap, GBool invert);
+
+  HtmlParams *params;		// conversion settings
   FILE *fContentsFrame;
   FILE *page;                   // html file
   //FILE *tin;                    // image log file
@@ -407,11 +560,18 @@ private:
   GBool rawOrder;		// keep text in content stream order
   GBool doOutline;		// output document outline
   GBool ok;			// set up ok?
+  GBool worker;			// worker device: collect pages, write nothing
+  HtmlStopwatch stopwatch;	// times the phases of a page, for -stats
+  HtmlWriter *streamWriter;	// -stream: the page being written, or NULL
+  HtmlStopwatch pageClock;	// time since the page was started, for
+				//   -page-timeout
+  HtmlPage *donePage;		// last page finished by a worker device
+  GString *imgExt;		// extension of background images
   GBool dumpJPEG;
   int pageNum;
   int maxPageWidth;
   int maxPageHeight;
-  static int imgNum;
+  int imgNum;
   GString *Docname;
   GString *docTitle;
   GList *glMetaVars;
@@ -0,0 +1,139 @@
+//========================================================================
+//
+// HtmlPNG.cc
+//
+//========================================================================
+
+#include <aconf.h>
+#include <string.h>
+#include "gmem.h"
+#include "HtmlPNG.h"
+
+// size of an IDAT chunk
+#define pngChunkSize (64 * 1024)
+
+static const Guchar pngSignature[8] = {
+  0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'
+};
+
+static void putU32(Guchar *p, Guint x) {
+  p[0] = (Guchar)(x >> 24);
+  p[1] = (Guchar)(x >> 16);
+  p[2] = (Guchar)(x >> 8);
+  p[3] = (Guchar)x;
+}
+
+//------------------------------------------------------------------------
+// HtmlPNGWriter
+//------------------------------------------------------------------------
+
+HtmlPNGWriter::HtmlPNGWriter(FILE *fA, int widthA, int heightA, int nCompsA,
+			     int level) {
+  Guchar ihdr[13];
+
+  f = fA;
+  width = widthA;
+  height = heightA;
+  nComps = nCompsA;
+  rowSize = width * nComps + 1;
+  prevRow = (Guchar *)gmalloc(rowSize);
+  memset(prevRow, 0, rowSize);
+  filtered = (Guchar *)gmalloc(rowSize);
+  outBuf = (Guchar *)gmalloc(pngChunkSize);
+  nRows = 0;
+
+  memset(&zs, 0, sizeof(zs));
+  ok = deflateInit(&zs, level) == Z_OK;
+  zs.next_out = outBuf;
+  zs.avail_out = pngChunkSize;
+
+  fwrite(pngSignature, 1, 8, f);
+  putU32(ihdr, width);
+  putU32(ihdr + 4, height);
+  ihdr[8] = 8;				// bit depth
+  ihdr[9] = nComps == 1 ? 0 : 2;	// gray or truecolor
+  ihdr[10] = 0;				// deflate
+  ihdr[11] = 0;				// adaptive filtering
+  ihdr[12] = 0;				// no interlace
+  writeChunk("IHDR", ihdr, 13);
+}
+
+HtmlPNGWriter::~HtmlPNGWriter() {
+  deflateEnd(&zs);
+  gfree(prevRow);
+  gfree(filtered);
+  gfree(outBuf);
+}
+
+GBool HtmlPNGWriter::writeRow(Guchar *row) {
+  int n, i;
+
+  if (!ok || nRows >= height) {
+    return gFalse;
+  }
+  // Up filter: scanned and rendered pages have long vertical runs, and
+  // it is cheaper than trying all five filters per row
+  n = rowSize - 1;
+  filtered[0] = 2;
+  for (i = 0; i < n; ++i) {
+    filtered[i + 1] = (Guchar)(row[i] - prevRow[i]);
+  }
+  memcpy(prevRow, row, n);
+  ++nRows;
+  return deflateData(filtered, rowSize, Z_NO_FLUSH);
+}
+
+GBool HtmlPNGWriter::finish() {
+  while (ok && nRows < height) {
+    // a short image is padded with blank rows, so the file stays valid
+    memset(filtered, 0, rowSize);
+    ++nRows;
+    deflateData(filtered, rowSize, Z_NO_FLUSH);
+  }
+  if (ok) {
+    deflateData(NULL, 0, Z_FINISH);
+  }
+  if (zs.next_out != outBuf) {
+    writeChunk("IDAT", outBuf, (int)(zs.next_out - outBuf));
+  }
+  writeChunk("IEND", NULL, 0);
+  return ok && !ferror(f);
+}
+
+GBool HtmlPNGWriter::deflateData(Guchar *data, int len, int flush) {
+  int ret;
+
+  zs.next_in = data;
+  zs.avail_in = len;
+  do {
+    ret = deflate(&zs, flush);
+    if (ret == Z_STREAM_ERROR) {
+      ok = gFalse;
+      return gFalse;
+    }
+    if (zs.avail_out == 0) {
+      writeChunk("IDAT", outBuf, pngChunkSize);
+      zs.next_out = outBuf;
+      zs.avail_out = pngChunkSize;
+    }
+  } while (zs.avail_in > 0 || (flush == Z_FINISH && ret != Z_STREAM_END));
+  return gTrue;
+}
+
+void HtmlPNGWriter::writeChunk(const char *type, Guchar *data, int len) {
+  Guchar buf[8];
+  uLong crc;
+
+  putU32(buf, len);
+  memcpy(buf + 4, type, 4);
+  fwrite(buf, 1, 8, f);
+  if (len > 0) {
+    fwrite(data, 1, len, f);
+  }
+  crc = crc32(0, (Bytef *)type, 4);
+  if (len > 0) {
+    crc = crc32(crc, data, len);
+  }
+  putU32(buf, (Guint)crc);
+  fwrite(buf, 1, 4, f);
+}
@@ -0,0 +1,54 @@
+//========================================================================
+//
+// HtmlPNG.h
+//
+// Minimal PNG encoder: 8-bit gray or RGB rows in, zlib-compressed
+// IDAT chunks out.  Used for the -c background images.
+//
+//========================================================================
+
+#ifndef HTMLPNG_H
+#define HTMLPNG_H
+
+#include <stdio.h>
+#include <zlib.h>
+#include "gtypes.h"
+
+//------------------------------------------------------------------------
+// HtmlPNGWriter
+//------------------------------------------------------------------------
+
+class HtmlPNGWriter {
+public:
+
+  // Start a <width> x <height> image on <f>, with 1 (gray) or 3 (RGB)
+  // bytes per pixel and the given zlib compression <level>.
+  HtmlPNGWriter(FILE *fA, int widthA, int heightA, int nCompsA,
+		int level = Z_DEFAULT_COMPRESSION);
+  ~HtmlPNGWriter();
+
+  // Add the next row (width * nComps bytes).
+  GBool writeRow(Guchar *row);
+
+  // Write the remaining data and the IEND chunk.  Returns false if
+  // anything went wrong since the image was started.
+  GBool finish();
+
+private:
+
+  void writeChunk(const char *type, Guchar *data, int len);
+  GBool deflateData(Guchar *data, int len, int flush);
+
+  FILE *f;
+  int width, height;
+  int nComps;
+  int rowSize;			// bytes per row, filter byte included
+  Guchar *prevRow;		// previous row, for the Up filter
+  Guchar *filtered;		// current row after filtering
+  Guchar *outBuf;		// compressed data for the next IDAT
+  z_stream zs;
+  int nRows;
+  GBool ok;
+};
+
+#endif
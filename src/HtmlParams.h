@@ -0,0 +1,130 @@
+//========================================================================
+//
+// HtmlParams.h
+//
+// Settings for a single pdftohtml conversion.  These used to be
+// globals in pdftohtml.cc and statics in HtmlOutputDev; keeping them
+// in one object lets several conversions (or several worker devices
+// of one conversion) run side by side.
+//
+//========================================================================
+
+#ifndef HTMLPARAMS_H
+#define HTMLPARAMS_H
+
+#include <stdio.h>
+#include "gtypes.h"
+
+class UnicodeMap;
+class HtmlImageCache;
+class HtmlStatsFile;
+class HtmlCheckpoint;
+
+class HtmlParams {
+public:
+
+  HtmlParams() {
+    firstPage = 1;
+    lastPage = 0;
+    nThreads = 1;
+    ownerPassword = NULL;
+    userPassword = NULL;
+    textEncName = NULL;
+    gsDevice = "png16m";
+    forceCopy = gFalse;
+    quiet = gFalse;
+    errorFunc = NULL;
+    errorData = NULL;
+    scale = 1.5;
+    complexMode = gFalse;
+    ignore = gFalse;
+    printCommands = gTrue;
+    printHtml = gFalse;
+    noframes = gFalse;
+    stout = gFalse;
+    xml = gFalse;
+    binary = gFalse;
+    jsonl = gFalse;
+    stream = gFalse;
+    showHidden = gFalse;
+    noMerge = gTrue;
+    doCoalesce = gTrue;
+    outputPaths = gFalse;
+    outputImages = gFalse;
+    coordPrecision = 3;
+    pathTolerance = 0;
+    maxPathPoints = 0;
+    pageTimeout = 0;
+    pageMem = 0;
+    checkpoint = gFalse;
+    imageCache = NULL;
+    stats = NULL;
+    uMap = NULL;
+    outFile = NULL;
+    ckpt = NULL;
+    pageDone = NULL;
+    pageDoneData = NULL;
+  }
+
+  int firstPage;		// first page to convert
+  int lastPage;			// last page to convert (0 = the last
+				//   page of the document)
+  int nThreads;			// pages to convert in parallel
+  char *ownerPassword;		// passwords for encrypted files (or
+  char *userPassword;		//   NULL)
+  char *textEncName;		// output text encoding (NULL = the
+				//   xpdfrc textEncoding)
+  char *gsDevice;		// background image type
+  GBool forceCopy;		// ignore the document's copy permission
+  GBool quiet;			// no progress messages or warnings
+  void (*errorFunc)(void *data, int category,	// receives the error
+		    int pos, const char *msg);	//   messages, even with
+  void *errorData;				//   quiet (or NULL)
+  double scale;			// zoom factor
+  GBool complexMode;		// generate complex (positioned) output
+  GBool ignore;			// ignore images
+  GBool printCommands;		// print link debugging info
+  GBool printHtml;		// exchange .pdf links by .html
+  GBool noframes;		// generate no frames
+  GBool stout;			// write to stdout
+  GBool xml;			// output for XML post-processing
+  GBool binary;			// write the -xml data in the binary
+				//   layout of HtmlBinary.h (implies xml)
+  GBool jsonl;			// write one JSON object per page line
+				//   (implies xml)
+  GBool stream;			// write the XML text as it is drawn,
+				//   in content stream order (implies xml)
+  GBool showHidden;		// output hidden text
+  GBool noMerge;		// do not merge paragraphs
+  GBool doCoalesce;		// combine the strings on a page
+  GBool outputPaths;		// include paths, rectangles, etc.
+  GBool outputImages;		// write images to files
+  int coordPrecision;		// digits after the decimal point for
+				//   coordinates in the XML output
+  double pathTolerance;		// simplify paths to within this distance
+				//   (0 = keep every point)
+  int maxPathPoints;		// at most this many path points per
+				//   page (0 = no limit)
+  int pageTimeout;		// stop interpreting a page after this
+				//   many milliseconds (0 = no limit)
+  int pageMem;			// stop interpreting a page when its
+				//   captured content takes this many
+				//   megabytes (0 = no limit)
+  GBool checkpoint;		// keep a checkpoint of the single output
+				//   file, and resume from it
+  HtmlImageCache *imageCache;	// files written for -images, shared by
+				//   the documents of a batch (or NULL)
+  HtmlStatsFile *stats;		// per-page statistics for -stats (or
+				//   NULL)
+
+  // Set up by HtmlConverter for each conversion.
+  UnicodeMap *uMap;		// map for textEncName
+  FILE *outFile;		// write the single output file (-noframes,
+				//   -xml) here instead of opening one (or
+				//   NULL); it is not closed
+  HtmlCheckpoint *ckpt;		// for checkpoint (or NULL)
+  void (*pageDone)(void *data, int pageNum);	// called after each page
+  void *pageDoneData;		//   has been written (or NULL)
+};
+
+#endif
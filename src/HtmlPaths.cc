@@ -0,0 +1,793 @@
+//========================================================================
+//
+// HtmlPaths.cc
+//
+//========================================================================
+
+#include <aconf.h>
+#include <string.h>
+#include <math.h>
+#include "gmem.h"
+#include "GfxState.h"
+#include "HtmlWriter.h"
+#include "HtmlPaths.h"
+
+//------------------------------------------------------------------------
+
+static inline unsigned int hashDouble(unsigned int h, double x) {
+  unsigned int w[2];
+
+  if (x == 0) {
+    x = 0;			// -0 and 0 compare equal
+  }
+  memcpy(w, &x, sizeof(w));
+  h = (h ^ w[0]) * 16777619u;
+  h = (h ^ w[1]) * 16777619u;
+  return h;
+}
+
+static unsigned int hashStyle(GfxRGB *fill, GfxRGB *stroke, double lineWidth,
+			      double *dash, int numDash, double dashStart) {
+  unsigned int h = 2166136261u;
+  int i;
+
+  h = (h ^ (unsigned int)fill->r) * 16777619u;
+  h = (h ^ (unsigned int)fill->g) * 16777619u;
+  h = (h ^ (unsigned int)fill->b) * 16777619u;
+  h = (h ^ (unsigned int)stroke->r) * 16777619u;
+  h = (h ^ (unsigned int)stroke->g) * 16777619u;
+  h = (h ^ (unsigned int)stroke->b) * 16777619u;
+  h = hashDouble(h, lineWidth);
+  h = (h ^ (unsigned int)numDash) * 16777619u;
+  for (i = 0; i < numDash; ++i) {
+    h = hashDouble(h, dash[i]);
+  }
+  if (numDash > 0) {
+    h = hashDouble(h, dashStart);
+  }
+  return h;
+}
+
+//------------------------------------------------------------------------
+// HtmlShading
+//------------------------------------------------------------------------
+
+// axial and radial shadings are sampled at this many intervals ...
+#define shadingSamples 256
+
+// ... and stops are dropped where linear interpolation between their
+// neighbours is within this distance (one 8-bit step)
+#define shadingColorDelta (gfxColorComp1 / 255)
+
+// Set the bounding box of shading space rectangle (<x0>,<y0>) ..
+// (<x1>,<y1>) in output coordinates.
+static void transformBBox(GfxState *state, double x0, double y0,
+			  double x1, double y1, double *xMin, double *yMin,
+			  double *xMax, double *yMax) {
+  double xs[4], ys[4];
+  int i;
+
+  state->transform(x0, y0, &xs[0], &ys[0]);
+  state->transform(x1, y0, &xs[1], &ys[1]);
+  state->transform(x1, y1, &xs[2], &ys[2]);
+  state->transform(x0, y1, &xs[3], &ys[3]);
+  *xMin = *xMax = xs[0];
+  *yMin = *yMax = ys[0];
+  for (i = 1; i < 4; ++i) {
+    if (xs[i] < *xMin) {
+      *xMin = xs[i];
+    } else if (xs[i] > *xMax) {
+      *xMax = xs[i];
+    }
+    if (ys[i] < *yMin) {
+      *yMin = ys[i];
+    } else if (ys[i] > *yMax) {
+      *yMax = ys[i];
+    }
+  }
+}
+
+HtmlShading::HtmlShading(GfxState *state, GfxShading *shading) {
+  GfxFunctionShading *fShading;
+  GfxColor color;
+  double *ctm, *m;
+  double x0, y0, x1, y1;
+  int i;
+
+  type = shading->getType();
+  nCoords = 0;
+  extend0 = extend1 = gFalse;
+  nElems = 0;
+  stopT = NULL;
+  stopRGB = NULL;
+  nStops = 0;
+  // Gfx has put the pattern matrix (if any) into the CTM already
+  ctm = state->getCTM();
+  for (i = 0; i < 6; ++i) {
+    mat[i] = ctm[i] == 0 ? 0 : ctm[i];	// no "-0"
+  }
+  if (shading->getHasBBox()) {
+    shading->getBBox(&x0, &y0, &x1, &y1);
+    transformBBox(state, x0, y0, x1, y1, &xMin, &yMin, &xMax, &yMax);
+  } else {
+    state->getClipBBox(&xMin, &yMin, &xMax, &yMax);
+  }
+
+  switch (type) {
+  case 1:
+    fShading = (GfxFunctionShading *)shading;
+    fShading->getDomain(&x0, &y0, &x1, &y1);
+    coords[0] = x0;
+    coords[1] = y0;
+    coords[2] = x1;
+    coords[3] = y1;
+    nCoords = 4;
+    m = fShading->getMatrix();
+    mat[0] = m[0] * ctm[0] + m[1] * ctm[2];
+    mat[1] = m[0] * ctm[1] + m[1] * ctm[3];
+    mat[2] = m[2] * ctm[0] + m[3] * ctm[2];
+    mat[3] = m[2] * ctm[1] + m[3] * ctm[3];
+    mat[4] = m[4] * ctm[0] + m[5] * ctm[2] + ctm[4];
+    mat[5] = m[4] * ctm[1] + m[5] * ctm[3] + ctm[5];
+    stopT = (double *)gmallocn(4, sizeof(double));
+    stopRGB = (GfxRGB *)gmallocn(4, sizeof(GfxRGB));
+    for (i = 0; i < 4; ++i) {
+      fShading->getColor(i == 1 || i == 2 ? x1 : x0, i >= 2 ? y1 : y0,
+			 &color);
+      shading->getColorSpace()->getRGB(&color, &stopRGB[i],
+				       gfxRenderingIntentAbsoluteColorimetric);
+      stopT[i] = i / 3.0;
+    }
+    nStops = 4;
+    break;
+  case 2:
+    ((GfxAxialShading *)shading)->getCoords(&coords[0], &coords[1],
+					    &coords[2], &coords[3]);
+    nCoords = 4;
+    extend0 = ((GfxAxialShading *)shading)->getExtend0();
+    extend1 = ((GfxAxialShading *)shading)->getExtend1();
+    sampleStops(shading, ((GfxAxialShading *)shading)->getDomain0(),
+		((GfxAxialShading *)shading)->getDomain1());
+    break;
+  case 3:
+    ((GfxRadialShading *)shading)->getCoords(&coords[0], &coords[1],
+					     &coords[2], &coords[3],
+					     &coords[4], &coords[5]);
+    nCoords = 6;
+    extend0 = ((GfxRadialShading *)shading)->getExtend0();
+    extend1 = ((GfxRadialShading *)shading)->getExtend1();
+    sampleStops(shading, ((GfxRadialShading *)shading)->getDomain0(),
+		((GfxRadialShading *)shading)->getDomain1());
+    break;
+  case 4:
+  case 5:
+    ((GfxGouraudTriangleShading *)shading)->getBBox(&x0, &y0, &x1, &y1);
+    transformBBox(state, x0, y0, x1, y1, &xMin, &yMin, &xMax, &yMax);
+    nElems = ((GfxGouraudTriangleShading *)shading)->getNTriangles();
+    break;
+  case 6:
+  case 7:
+    ((GfxPatchMeshShading *)shading)->getBBox(&x0, &y0, &x1, &y1);
+    transformBBox(state, x0, y0, x1, y1, &xMin, &yMin, &xMax, &yMax);
+    nElems = ((GfxPatchMeshShading *)shading)->getNPatches();
+    break;
+  }
+}
+
+HtmlShading::~HtmlShading() {
+  gfree(stopT);
+  gfree(stopRGB);
+}
+
+size_t HtmlShading::getMemUsed() {
+  return sizeof(HtmlShading) +
+         (size_t)nStops * (sizeof(double) + sizeof(GfxRGB));
+}
+
+// Sample the color function of an axial or radial shading over
+// [<t0>,<t1>] and keep the fewest stops that reproduce it.
+void HtmlShading::sampleStops(GfxShading *shading, double t0, double t1) {
+  GfxColor color;
+  GfxRGB rgb[shadingSamples + 1];
+  GBool fits;
+  double f;
+  int i, j, k, e;
+
+  for (i = 0; i <= shadingSamples; ++i) {
+    if (type == 2) {
+      ((GfxAxialShading *)shading)->getColor(
+			      t0 + (t1 - t0) * i / shadingSamples, &color);
+    } else {
+      ((GfxRadialShading *)shading)->getColor(
+			      t0 + (t1 - t0) * i / shadingSamples, &color);
+    }
+    shading->getColorSpace()->getRGB(&color, &rgb[i],
+				     gfxRenderingIntentAbsoluteColorimetric);
+  }
+
+  stopT = (double *)gmallocn(shadingSamples + 1, sizeof(double));
+  stopRGB = (GfxRGB *)gmallocn(shadingSamples + 1, sizeof(GfxRGB));
+  stopT[0] = 0;
+  stopRGB[0] = rgb[0];
+  nStops = 1;
+
+  // grow each run from the last stop <k> for as long as the samples
+  // in between stay on the line from <k> to its end
+  k = 0;
+  for (e = 2; e <= shadingSamples; ++e) {
+    fits = gTrue;
+    for (j = k + 1; j < e && fits; ++j) {
+      f = (double)(j - k) / (e - k);
+      fits = fabs(rgb[j].r - (rgb[k].r + f * (rgb[e].r - rgb[k].r)))
+	       <= shadingColorDelta &&
+	     fabs(rgb[j].g - (rgb[k].g + f * (rgb[e].g - rgb[k].g)))
+	       <= shadingColorDelta &&
+	     fabs(rgb[j].b - (rgb[k].b + f * (rgb[e].b - rgb[k].b)))
+	       <= shadingColorDelta;
+    }
+    if (!fits) {
+      k = e - 1;
+      stopT[nStops] = (double)k / shadingSamples;
+      stopRGB[nStops] = rgb[k];
+      ++nStops;
+    }
+  }
+  stopT[nStops] = 1;
+  stopRGB[nStops] = rgb[shadingSamples];
+  ++nStops;
+  stopT = (double *)greallocn(stopT, nStops, sizeof(double));
+  stopRGB = (GfxRGB *)greallocn(stopRGB, nStops, sizeof(GfxRGB));
+}
+
+void HtmlShading::dumpAsXML(HtmlWriter *w, int prec) {
+  int i;
+
+  w->put("<shading type=\"");
+  w->putInt(type);
+  w->put("\" bbox=\"");
+  w->putDouble(xMin, prec);
+  w->put(',');
+  w->putDouble(yMin, prec);
+  w->put(',');
+  w->putDouble(xMax, prec);
+  w->put(',');
+  w->putDouble(yMax, prec);
+  w->put('"');
+  if (nCoords > 0) {
+    w->put(" coords=\"");
+    for (i = 0; i < nCoords; ++i) {
+      if (i > 0) {
+	w->put(',');
+      }
+      w->putDouble(coords[i], prec);
+    }
+    w->put("\" matrix=\"");
+    for (i = 0; i < 6; ++i) {
+      if (i > 0) {
+	w->put(',');
+      }
+      w->putDouble(mat[i], i < 4 ? 6 : prec);
+    }
+    w->put('"');
+  }
+  if (type == 2 || type == 3) {
+    w->put(" extend=\"");
+    w->putInt(extend0);
+    w->put(',');
+    w->putInt(extend1);
+    w->put('"');
+  }
+  if (nElems > 0) {
+    w->put(" n=\"");
+    w->putInt(nElems);
+    w->put('"');
+  }
+  if (nStops > 0) {
+    // "offset r,g,b;..."; for type 1, the colors at the corners of the
+    // domain, (x0,y0) (x1,y0) (x1,y1) (x0,y1)
+    w->put(type == 1 ? " colors=\"" : " colorstops=\"");
+    for (i = 0; i < nStops; ++i) {
+      if (i > 0) {
+	w->put(';');
+      }
+      if (type != 1) {
+	w->putDouble(stopT[i], 3);
+	w->put(' ');
+      }
+      w->putInt(stopRGB[i].r);
+      w->put(',');
+      w->putInt(stopRGB[i].g);
+      w->put(',');
+      w->putInt(stopRGB[i].b);
+    }
+    w->put('"');
+  }
+  w->put("/>\n");
+}
+
+//------------------------------------------------------------------------
+// HtmlPaths
+//------------------------------------------------------------------------
+
+HtmlPaths::HtmlPaths() {
+  pointsSize = 256;
+  xs = (double *)gmallocn(pointsSize, sizeof(double));
+  ys = (double *)gmallocn(pointsSize, sizeof(double));
+  subsSize = 16;
+  subStart = (int *)gmallocn(subsSize + 1, sizeof(int));
+  pathsSize = 16;
+  pathSub = (int *)gmallocn(pathsSize + 1, sizeof(int));
+  pathStyle = (int *)gmallocn(pathsSize, sizeof(int));
+  stylesSize = 16;
+  styles = (HtmlPathStyle *)gmallocn(stylesSize, sizeof(HtmlPathStyle));
+  dashesSize = 16;
+  dashes = (double *)gmallocn(dashesSize, sizeof(double));
+  hashSize = 64;
+  hashTab = (int *)gmallocn(hashSize, sizeof(int));
+  shadingsSize = 4;
+  shadings = (HtmlShading **)gmallocn(shadingsSize, sizeof(HtmlShading *));
+  nShadings = 0;
+  keep = NULL;
+  stack = NULL;
+  keepSize = 0;
+  reset();
+}
+
+HtmlPaths::~HtmlPaths() {
+  int i;
+
+  for (i = 0; i < nShadings; ++i) {
+    delete shadings[i];
+  }
+  gfree(xs);
+  gfree(ys);
+  gfree(subStart);
+  gfree(pathSub);
+  gfree(pathStyle);
+  gfree(styles);
+  gfree(dashes);
+  gfree(hashTab);
+  gfree(shadings);
+  gfree(keep);
+  gfree(stack);
+}
+
+size_t HtmlPaths::getMemUsed() {
+  size_t n;
+
+  n = (size_t)nPoints * 2 * sizeof(double) +
+      (size_t)nSubs * sizeof(int) +
+      (size_t)nPaths * 2 * sizeof(int) +
+      (size_t)nStyles * sizeof(HtmlPathStyle) +
+      (size_t)nDashes * sizeof(double) +
+      shadingMem;
+  return n;
+}
+
+void HtmlPaths::reset() {
+  int i;
+
+  nPoints = 0;
+  nSubs = 0;
+  subStart[0] = 0;
+  nPaths = 0;
+  pathSub[0] = 0;
+  nStyles = 0;
+  nDashes = 0;
+  for (i = 0; i < nShadings; ++i) {
+    delete shadings[i];
+  }
+  nShadings = 0;
+  shadingMem = 0;
+  totalPoints = 0;
+  nOmitted = 0;
+  for (i = 0; i < hashSize; ++i) {
+    hashTab[i] = -1;
+  }
+}
+
+void HtmlPaths::addPath(GfxState *state) {
+  GfxPath *path;
+  GfxSubpath *sp;
+  int nSubsA, n, i, j;
+
+  path = state->getPath();
+  nSubsA = path->getNumSubpaths();
+
+  if (nPaths == pathsSize) {
+    pathsSize *= 2;
+    pathSub = (int *)greallocn(pathSub, pathsSize + 1, sizeof(int));
+    pathStyle = (int *)greallocn(pathStyle, pathsSize, sizeof(int));
+  }
+  if (nSubs + nSubsA > subsSize) {
+    while (nSubs + nSubsA > subsSize) {
+      subsSize *= 2;
+    }
+    subStart = (int *)greallocn(subStart, subsSize + 1, sizeof(int));
+  }
+
+  for (i = 0; i < nSubsA; ++i) {
+    sp = path->getSubpath(i);
+    n = sp->getNumPoints();
+    if (nPoints + n > pointsSize) {
+      while (nPoints + n > pointsSize) {
+	pointsSize *= 2;
+      }
+      xs = (double *)greallocn(xs, pointsSize, sizeof(double));
+      ys = (double *)greallocn(ys, pointsSize, sizeof(double));
+    }
+    for (j = 0; j < n; ++j) {
+      xs[nPoints + j] = sp->getX(j);
+      ys[nPoints + j] = sp->getY(j);
+    }
+    nPoints += n;
+    subStart[++nSubs] = nPoints;
+  }
+
+  pathStyle[nPaths] = internStyle(state);
+  pathSub[++nPaths] = nSubs;
+}
+
+void HtmlPaths::addShading(GfxState *state, GfxShading *shading) {
+  if (nShadings == shadingsSize) {
+    shadingsSize *= 2;
+    shadings = (HtmlShading **)greallocn(shadings, shadingsSize,
+					 sizeof(HtmlShading *));
+  }
+  shadings[nShadings] = new HtmlShading(state, shading);
+  shadingMem += shadings[nShadings]->getMemUsed();
+  ++nShadings;
+}
+
+GBool HtmlPaths::sameStyle(HtmlPathStyle *style, GfxRGB *fill, GfxRGB *stroke,
+			   double lineWidth, double *dash, int numDash,
+			   double dashStart) {
+  int i;
+
+  if (style->fill.r != fill->r || style->fill.g != fill->g ||
+      style->fill.b != fill->b ||
+      style->stroke.r != stroke->r || style->stroke.g != stroke->g ||
+      style->stroke.b != stroke->b ||
+      style->lineWidth != lineWidth ||
+      style->numDash != numDash) {
+    return gFalse;
+  }
+  if (numDash == 0) {
+    return gTrue;
+  }
+  if (style->dashStart != dashStart) {
+    return gFalse;
+  }
+  for (i = 0; i < numDash; ++i) {
+    if (dashes[style->firstDash + i] != dash[i]) {
+      return gFalse;
+    }
+  }
+  return gTrue;
+}
+
+// Return the index of the style currently set in <state>, adding it to
+// the table if it is new.
+int HtmlPaths::internStyle(GfxState *state) {
+  GfxRGB fill, stroke;
+  HtmlPathStyle *style;
+  double *dash;
+  double lineWidth, dashStart;
+  int numDash, h, i;
+
+  state->getFillColorSpace()->getRGB(state->getFillColor(), &fill
+#ifdef OLD_VERSION
+#else
+				     , gfxRenderingIntentAbsoluteColorimetric
+#endif
+				     );
+  state->getStrokeColorSpace()->getRGB(state->getStrokeColor(), &stroke
+#ifdef OLD_VERSION
+#else
+				       , gfxRenderingIntentAbsoluteColorimetric
+#endif
+				       );
+  lineWidth = state->getLineWidth();
+  state->getLineDash(&dash, &numDash, &dashStart);
+  if (numDash < 0) {
+    numDash = 0;
+  }
+
+  h = (int)(hashStyle(&fill, &stroke, lineWidth, dash, numDash, dashStart)
+	    & (hashSize - 1));
+  while (hashTab[h] >= 0) {
+    if (sameStyle(&styles[hashTab[h]], &fill, &stroke, lineWidth,
+		  dash, numDash, dashStart)) {
+      return hashTab[h];
+    }
+    h = (h + 1) & (hashSize - 1);
+  }
+
+  if (nStyles == stylesSize) {
+    stylesSize *= 2;
+    styles = (HtmlPathStyle *)greallocn(styles, stylesSize,
+					sizeof(HtmlPathStyle));
+  }
+  if (nDashes + numDash > dashesSize) {
+    while (nDashes + numDash > dashesSize) {
+      dashesSize *= 2;
+    }
+    dashes = (double *)greallocn(dashes, dashesSize, sizeof(double));
+  }
+  style = &styles[nStyles];
+  style->fill = fill;
+  style->stroke = stroke;
+  style->lineWidth = lineWidth;
+  style->firstDash = nDashes;
+  style->numDash = numDash;
+  style->dashStart = dashStart;
+  for (i = 0; i < numDash; ++i) {
+    dashes[nDashes++] = dash[i];
+  }
+  hashTab[h] = nStyles;
+  if (2 * ++nStyles > hashSize) {
+    rehash();
+  }
+  return nStyles - 1;
+}
+
+void HtmlPaths::rehash() {
+  HtmlPathStyle *style;
+  int i, h;
+
+  gfree(hashTab);
+  hashSize *= 2;
+  hashTab = (int *)gmallocn(hashSize, sizeof(int));
+  for (i = 0; i < hashSize; ++i) {
+    hashTab[i] = -1;
+  }
+  for (i = 0; i < nStyles; ++i) {
+    style = &styles[i];
+    h = (int)(hashStyle(&style->fill, &style->stroke, style->lineWidth,
+			dashes + style->firstDash, style->numDash,
+			style->dashStart)
+	      & (hashSize - 1));
+    while (hashTab[h] >= 0) {
+      h = (h + 1) & (hashSize - 1);
+    }
+    hashTab[h] = i;
+  }
+}
+
+void HtmlPaths::dumpStyleAsXMLAttrs(HtmlWriter *w, HtmlPathStyle *style,
+				    int prec) {
+  int i;
+
+  w->put("lineWidth=\"");
+  w->putDouble(style->lineWidth, prec);
+  w->put("\" fill.color=\"");
+  w->putInt(style->fill.r);
+  w->put(',');
+  w->putInt(style->fill.g);
+  w->put(',');
+  w->putInt(style->fill.b);
+  w->put("\"  stroke.color=\"");
+  w->putInt(style->stroke.r);
+  w->put(',');
+  w->putInt(style->stroke.g);
+  w->put(',');
+  w->putInt(style->stroke.b);
+  w->put("\" ");
+
+  if (style->numDash > 0) {
+    w->put("dashes=\"");
+    for (i = 0; i < style->numDash; ++i) {
+      w->putDouble(dashes[style->firstDash + i], prec);
+      if (i < style->numDash - 1) {
+	w->put(',');
+      }
+    }
+    w->put("\" startDash=\"");
+    w->putDouble(style->dashStart, prec);
+    w->put("\" ");
+  }
+}
+
+void HtmlPaths::simplify(double tolerance, int maxPoints) {
+  int i;
+
+  if (tolerance > 0) {
+    joinSegments(tolerance);
+    reduce(tolerance);
+  }
+  totalPoints = nPoints;
+  nOmitted = 0;
+  if (maxPoints > 0 && nPoints > maxPoints) {
+    for (i = 0; i < nPaths && subStart[pathSub[i + 1]] <= maxPoints; ++i) ;
+    nOmitted = nPaths - i;
+    nPaths = i;
+    nSubs = pathSub[nPaths];
+    nPoints = subStart[nSubs];
+  }
+}
+
+// The compaction loops below write the arrays in place.  The output
+// indexes never pass the input ones, and each boundary is read before
+// the slot it lives in can be overwritten.
+
+// Append each single-subpath path to the one before it when both have
+// the same style, neither is closed, and the second starts where the
+// first ends.  Plots and maps often draw a polyline as a long run of
+// separate two-point strokes.
+void HtmlPaths::joinSegments(double tolerance) {
+  double dx, dy;
+  int i, s, s1, a, b, p0, op, os, on, sa;
+
+  op = os = on = 0;
+  a = 0;
+  sa = 0;
+  for (i = 0; i < nPaths; ++i) {
+    s1 = pathSub[i + 1];
+    if (on > 0 && s1 - sa == 1 && pathSub[on] - pathSub[on - 1] == 1 &&
+	pathStyle[on - 1] == pathStyle[i]) {
+      b = subStart[sa + 1];
+      p0 = subStart[os - 1];
+      dx = xs[a] - xs[op - 1];
+      dy = ys[a] - ys[op - 1];
+      if (b - a >= 2 && op - p0 >= 2 &&
+	  (xs[a] != xs[b - 1] || ys[a] != ys[b - 1]) &&
+	  (xs[p0] != xs[op - 1] || ys[p0] != ys[op - 1]) &&
+	  dx * dx + dy * dy <= tolerance * tolerance) {
+	memmove(xs + op, xs + a + 1, (b - a - 1) * sizeof(double));
+	memmove(ys + op, ys + a + 1, (b - a - 1) * sizeof(double));
+	op += b - a - 1;
+	subStart[os] = op;
+	a = b;
+	sa = s1;
+	continue;
+      }
+    }
+    for (s = sa; s < s1; ++s) {
+      b = subStart[s + 1];
+      if (op != a) {
+	memmove(xs + op, xs + a, (b - a) * sizeof(double));
+	memmove(ys + op, ys + a, (b - a) * sizeof(double));
+      }
+      op += b - a;
+      subStart[++os] = op;
+      a = b;
+    }
+    sa = s1;
+    pathStyle[on] = pathStyle[i];
+    pathSub[++on] = os;
+  }
+  nPaths = on;
+  nSubs = os;
+  nPoints = op;
+}
+
+// Reduce every subpath, dropping the subpaths (and then paths) that
+// vanish.
+void HtmlPaths::reduce(double tolerance) {
+  int i, s, s1, a, b, n, op, os, on, sa;
+
+  op = os = on = 0;
+  a = 0;
+  sa = 0;
+  for (i = 0; i < nPaths; ++i) {
+    s1 = pathSub[i + 1];
+    for (s = sa; s < s1; ++s) {
+      b = subStart[s + 1];
+      n = reduceSubpath(xs + a, ys + a, b - a, tolerance);
+      if (n > 0) {
+	if (op != a) {
+	  memmove(xs + op, xs + a, n * sizeof(double));
+	  memmove(ys + op, ys + a, n * sizeof(double));
+	}
+	op += n;
+	subStart[++os] = op;
+      }
+      a = b;
+    }
+    sa = s1;
+    if (os > pathSub[on]) {
+      pathStyle[on] = pathStyle[i];
+      pathSub[++on] = os;
+    }
+  }
+  nPaths = on;
+  nSubs = os;
+  nPoints = op;
+}
+
+// Simplify the <n> points at <x>,<y> in place and return the new count,
+// or 0 if the whole subpath fits in a <tolerance> square.  Subpaths of
+// up to five points are left as they are, so rectangles stay
+// rectangles.
+int HtmlPaths::reduceSubpath(double *x, double *y, int n, double tolerance) {
+  double xMin, xMax, yMin, yMax, dx, dy, len2, d, dMax, t, tol2;
+  int sp, i, a, b, iMax, m;
+
+  if (n == 0) {
+    return 0;
+  }
+  xMin = xMax = x[0];
+  yMin = yMax = y[0];
+  for (i = 1; i < n; ++i) {
+    if (x[i] < xMin) {
+      xMin = x[i];
+    } else if (x[i] > xMax) {
+      xMax = x[i];
+    }
+    if (y[i] < yMin) {
+      yMin = y[i];
+    } else if (y[i] > yMax) {
+      yMax = y[i];
+    }
+  }
+  if (xMax - xMin < tolerance && yMax - yMin < tolerance) {
+    return 0;
+  }
+  if (n <= 5) {
+    return n;
+  }
+
+  if (n > keepSize) {
+    keepSize = n;
+    keep = (char *)grealloc(keep, keepSize);
+    stack = (int *)greallocn(stack, 2 * keepSize, sizeof(int));
+  }
+  memset(keep, 0, n);
+  keep[0] = keep[n - 1] = 1;
+
+  // Douglas-Peucker, with an explicit stack of (a, b) intervals; the
+  // pending intervals never overlap, so there are fewer than n of them
+  tol2 = tolerance * tolerance;
+  sp = 0;
+  stack[sp++] = 0;
+  stack[sp++] = n - 1;
+  while (sp > 0) {
+    b = stack[--sp];
+    a = stack[--sp];
+    if (b - a < 2) {
+      continue;
+    }
+    dx = x[b] - x[a];
+    dy = y[b] - y[a];
+    len2 = dx * dx + dy * dy;
+    dMax = -1;
+    iMax = a;
+    for (i = a + 1; i < b; ++i) {
+      if (len2 == 0) {
+	d = (x[i] - x[a]) * (x[i] - x[a]) + (y[i] - y[a]) * (y[i] - y[a]);
+      } else {
+	t = (x[i] - x[a]) * dy - (y[i] - y[a]) * dx;
+	d = t * t / len2;
+      }
+      if (d > dMax) {
+	dMax = d;
+	iMax = i;
+      }
+    }
+    if (dMax > tol2) {
+      keep[iMax] = 1;
+      stack[sp++] = a;
+      stack[sp++] = iMax;
+      stack[sp++] = iMax;
+      stack[sp++] = b;
+    }
+  }
+
+  // copy the kept points down, skipping segments shorter than the
+  // tolerance; the end points always stay
+  m = 1;
+  for (i = 1; i < n - 1; ++i) {
+    if (keep[i]) {
+      dx = x[i] - x[m - 1];
+      dy = y[i] - y[m - 1];
+      if (dx * dx + dy * dy >= tol2) {
+	x[m] = x[i];
+	y[m] = y[i];
+	++m;
+      }
+    }
+  }
+  x[m] = x[n - 1];
+  y[m] = y[n - 1];
+  return m + 1;
+}
@@ -0,0 +1,186 @@
+//========================================================================
+//
+// HtmlPaths.h
+//
+// The paths (fills and strokes) of a page, kept in flat arrays: the
+// points of all subpaths, one after the other, the subpath and path
+// boundaries as offsets into those, and each path's drawing attributes
+// as an index into a table of distinct styles.  Shaded fills are kept
+// as one summary record each.
+//
+//========================================================================
+
+#ifndef HTMLPATHS_H
+#define HTMLPATHS_H
+
+#include "gtypes.h"
+#include "GfxState.h"
+
+class HtmlWriter;
+class GfxShading;
+
+//------------------------------------------------------------------------
+// HtmlPathStyle
+//------------------------------------------------------------------------
+
+struct HtmlPathStyle {
+  GfxRGB fill;
+  GfxRGB stroke;
+  double lineWidth;
+  int firstDash;		// first dash length, in HtmlPaths::dashes
+  int numDash;			// number of dash lengths
+  double dashStart;		// dash phase
+};
+
+//------------------------------------------------------------------------
+// HtmlShading
+//------------------------------------------------------------------------
+
+// A shaded fill ('sh' operator or shading pattern), described by its
+// geometry and colors instead of the many small fills Gfx would draw.
+// The area covered is in output coordinates, like the text.  The axis,
+// circles or domain stay in shading space, where circles are circles,
+// along with the matrix that maps them to output coordinates.
+class HtmlShading {
+public:
+
+  HtmlShading(GfxState *state, GfxShading *shading);
+  ~HtmlShading();
+
+  // Write a <shading> element, with <prec> decimals for coordinates.
+  void dumpAsXML(HtmlWriter *w, int prec);
+
+  // Memory used by this record and its color stops.
+  size_t getMemUsed();
+
+private:
+
+  void sampleStops(GfxShading *shading, double t0, double t1);
+
+  int type;			// shading type, 1 .. 7
+  double xMin, yMin, xMax, yMax;	// area covered
+  double coords[6];		// axis (type 2), circles (type 3) or
+  int nCoords;			//   domain (type 1)
+  double mat[6];		// coords to output coordinates: the CTM
+				//   (with the pattern matrix), after the
+				//   shading's own matrix for type 1
+  GBool extend0, extend1;	// types 2 and 3
+  int nElems;			// triangles or patches (types 4 .. 7)
+  double *stopT;		// color stop offsets, 0 .. 1
+  GfxRGB *stopRGB;		// color stop colors (corner colors for
+  int nStops;			//   type 1)
+};
+
+//------------------------------------------------------------------------
+// HtmlPaths
+//------------------------------------------------------------------------
+
+class HtmlPaths {
+public:
+
+  HtmlPaths();
+  ~HtmlPaths();
+
+  // Record the current path of <state>, with the fill and stroke
+  // colors, line width and dash pattern in effect.  The coordinates
+  // are stored as they are in the path.
+  void addPath(GfxState *state);
+
+  int getNumPaths() { return nPaths; }
+  int getNumSubpaths(int path)
+    { return pathSub[path + 1] - pathSub[path]; }
+  int getFirstSubpath(int path) { return pathSub[path]; }
+  HtmlPathStyle *getStyle(int path) { return &styles[pathStyle[path]]; }
+  int getStyleIndex(int path) { return pathStyle[path]; }
+
+  // Totals over the page, for the -binary output.
+  int getNumAllSubpaths() { return nSubs; }
+  int getNumAllPoints() { return nPoints; }
+  int getNumStyles() { return nStyles; }
+  HtmlPathStyle *getStyleAt(int i) { return &styles[i]; }
+  int getNumDashes() { return nDashes; }
+  double *getDashes() { return dashes; }
+
+  // Points of subpath <sub> (counted over the whole page).
+  int getFirstPoint(int sub) { return subStart[sub]; }
+  int getNumPoints(int sub) { return subStart[sub + 1] - subStart[sub]; }
+  double *getX(int sub) { return xs + subStart[sub]; }
+  double *getY(int sub) { return ys + subStart[sub]; }
+
+  // Record a shaded fill.
+  void addShading(GfxState *state, GfxShading *shading);
+  int getNumShadings() { return nShadings; }
+  HtmlShading *getShading(int i) { return shadings[i]; }
+
+  // Write the attributes of <style> (lineWidth, colors, dashes), with
+  // <prec> decimals.
+  void dumpStyleAsXMLAttrs(HtmlWriter *w, HtmlPathStyle *style, int prec);
+
+  // Reduce the geometry before it is written.  With a <tolerance>
+  // above 0, abutting single-subpath paths of the same style are joined
+  // into one polyline, points that stay within <tolerance> of the line
+  // through their neighbours are removed (Douglas-Peucker), and
+  // segments and subpaths smaller than <tolerance> are dropped.  With
+  // <maxPoints> above 0, the paths after the first <maxPoints> points
+  // are omitted (whole paths are kept or dropped).
+  void simplify(double tolerance, int maxPoints);
+
+  // After simplify(): the number of points before the cut-off, and the
+  // number of paths that were omitted because of it.
+  int getTotalPoints() { return totalPoints; }
+  int getNumOmitted() { return nOmitted; }
+
+  // Forget all paths.  The arrays are kept for the next page.
+  void reset();
+
+  // Memory taken by the paths recorded since the last reset().
+  size_t getMemUsed();
+
+private:
+
+  int internStyle(GfxState *state);
+  GBool sameStyle(HtmlPathStyle *style, GfxRGB *fill, GfxRGB *stroke,
+		  double lineWidth, double *dash, int numDash,
+		  double dashStart);
+  void rehash();
+  void joinSegments(double tolerance);
+  void reduce(double tolerance);
+  int reduceSubpath(double *x, double *y, int n, double tolerance);
+
+  double *xs, *ys;		// points of all subpaths
+  int nPoints;
+  int pointsSize;
+
+  int *subStart;		// first point of each subpath, plus the
+				//   end of the last one
+  int nSubs;
+  int subsSize;
+
+  int *pathSub;			// first subpath of each path, plus the
+				//   end of the last one
+  int *pathStyle;		// style index of each path
+  int nPaths;
+  int pathsSize;
+
+  HtmlPathStyle *styles;	// distinct styles of the page
+  int nStyles;
+  int stylesSize;
+  double *dashes;		// dash lengths of all styles
+  int nDashes;
+  int dashesSize;
+  HtmlShading **shadings;
+  int nShadings;
+  int shadingsSize;
+  size_t shadingMem;		// getMemUsed() of the shadings
+
+  int totalPoints;		// points before the maxPoints cut-off
+  int nOmitted;			// paths dropped by the cut-off
+  char *keep;			// scratch for reduceSubpath
+  int *stack;			//   (both keepSize long)
+  int keepSize;
+
+  int *hashTab;			// open-addressed: style index or -1
+  int hashSize;			// power of 2
+};
+
+#endif
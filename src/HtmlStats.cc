@@ -0,0 +1,125 @@
+//========================================================================
+//
+// HtmlStats.cc
+//
+//========================================================================
+
+#include <aconf.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include "GString.h"
+#include "Error.h"
+#include "HtmlStats.h"
+
+static const char *phaseNames[htmlNumPhases] = {
+  "parse", "interpret", "layout", "dump"
+};
+
+//------------------------------------------------------------------------
+// HtmlPageStats
+//------------------------------------------------------------------------
+
+void HtmlPageStats::clear() {
+  memset(this, 0, sizeof(*this));
+}
+
+//------------------------------------------------------------------------
+// HtmlStopwatch
+//------------------------------------------------------------------------
+
+static void getTimes(double *wall, double *cpu) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  *wall = ts.tv_sec + ts.tv_nsec * 1e-9;
+#ifdef CLOCK_THREAD_CPUTIME_ID
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+#else
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+#endif
+  *cpu = ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void HtmlStopwatch::start() {
+  getTimes(&wall, &cpu);
+}
+
+void HtmlStopwatch::lap(HtmlPageStats *stats, HtmlPhase phase) {
+  double wall1, cpu1;
+
+  getTimes(&wall1, &cpu1);
+  stats->wall[phase] += wall1 - wall;
+  stats->cpu[phase] += cpu1 - cpu;
+  wall = wall1;
+  cpu = cpu1;
+}
+
+double HtmlStopwatch::elapsed() {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9 - wall;
+}
+
+//------------------------------------------------------------------------
+// HtmlStatsFile
+//------------------------------------------------------------------------
+
+HtmlStatsFile::HtmlStatsFile(char *fileName) {
+  if (!strcmp(fileName, "-")) {
+    f = stderr;
+  } else if (!(f = fopen(fileName, "w"))) {
+    error(errIO, -1, "Couldn't open stats file '{0:s}'", fileName);
+  }
+  docName = new GString();
+}
+
+HtmlStatsFile::~HtmlStatsFile() {
+  if (f && f != stderr) {
+    fclose(f);
+  }
+  delete docName;
+}
+
+void HtmlStatsFile::startDoc(char *docNameA) {
+  delete docName;
+  docName = new GString(docNameA);
+}
+
+void HtmlStatsFile::writePage(int pageNum, HtmlPageStats *stats) {
+  struct rusage ru;
+  const char *p;
+  int i;
+
+  if (!f) {
+    return;
+  }
+  fputs("{\"file\":\"", f);
+  for (p = docName->getCString(); *p; ++p) {
+    if (*p == '"' || *p == '\\') {
+      fprintf(f, "\\%c", *p);
+    } else if ((unsigned char)*p < 0x20) {
+      fprintf(f, "\\u%04x", *p);
+    } else {
+      fputc(*p, f);
+    }
+  }
+  fprintf(f, "\",\"page\":%d,\"wall\":{", pageNum);
+  for (i = 0; i < htmlNumPhases; ++i) {
+    fprintf(f, "%s\"%s\":%.6f", i ? "," : "", phaseNames[i], stats->wall[i]);
+  }
+  fputs("},\"cpu\":{", f);
+  for (i = 0; i < htmlNumPhases; ++i) {
+    fprintf(f, "%s\"%s\":%.6f", i ? "," : "", phaseNames[i], stats->cpu[i]);
+  }
+  fprintf(f, "},\"chars\":%d,\"strings\":%d,\"paths\":%d,\"points\":%d,"
+	  "\"images\":%d,\"links\":%d,\"fonts\":%d,\"bytes\":%.0f",
+	  stats->chars, stats->strings, stats->paths, stats->points,
+	  stats->images, stats->links, stats->fonts, stats->bytes);
+  // ru_maxrss is in kilobytes on Linux and the BSDs
+  getrusage(RUSAGE_SELF, &ru);
+  fprintf(f, ",\"peakRSS\":%.0f}\n", (double)ru.ru_maxrss * 1024);
+  fflush(f);
+}
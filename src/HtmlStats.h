@@ -0,0 +1,102 @@
+//========================================================================
+//
+// HtmlStats.h
+//
+// Per-page statistics for -stats: where the time went (wall clock and
+// CPU, by phase), how much was captured, and how much was written.
+// One JSON object per page is appended to the stats file, so a slow
+// document in a batch can be looked at page by page.
+//
+//========================================================================
+
+#ifndef HTMLSTATS_H
+#define HTMLSTATS_H
+
+#include <stdio.h>
+#include "gtypes.h"
+
+class GString;
+
+//------------------------------------------------------------------------
+
+// Phases of a page.  Gfx parses the content stream while it interprets
+// it, so "interpret" includes the content stream parsing; "parse" is
+// the page setup before the first operator (page attributes,
+// resources, Gfx state).
+enum HtmlPhase {
+  htmlPhaseParse,
+  htmlPhaseInterpret,
+  htmlPhaseLayout,		// sort, merge and coalesce, simplify
+  htmlPhaseDump,		// write the page
+  htmlNumPhases
+};
+
+//------------------------------------------------------------------------
+// HtmlPageStats
+//------------------------------------------------------------------------
+
+struct HtmlPageStats {
+  double wall[htmlNumPhases];	// seconds
+  double cpu[htmlNumPhases];	// seconds, of the thread doing the work
+  int chars;			// characters passed to addChar
+  int strings;			// strings ended
+  int paths;			// paths captured by addFill
+  int points;			//   and their points
+  int images;
+  int links;
+  int fonts;			// distinct fonts used by the strings
+  double bytes;			// bytes written for the page
+
+  void clear();
+};
+
+//------------------------------------------------------------------------
+// HtmlStopwatch
+//------------------------------------------------------------------------
+
+// Wall clock and CPU time of the calling thread, for timing the
+// phases of a page.
+class HtmlStopwatch {
+public:
+
+  // Start (or restart) timing.
+  void start();
+
+  // Add the time since start() to <stats>' <phase>, and restart.
+  void lap(HtmlPageStats *stats, HtmlPhase phase);
+
+  // Wall clock seconds since start().
+  double elapsed();
+
+private:
+
+  double wall, cpu;
+};
+
+//------------------------------------------------------------------------
+// HtmlStatsFile
+//------------------------------------------------------------------------
+
+class HtmlStatsFile {
+public:
+
+  // Open <fileName> for writing ("-" for stderr).
+  HtmlStatsFile(char *fileName);
+  ~HtmlStatsFile();
+
+  GBool isOk() { return f != NULL; }
+
+  // Start a new document; the following pages are recorded under
+  // <docName>.
+  void startDoc(char *docName);
+
+  // Write the record of page <pageNum>.
+  void writePage(int pageNum, HtmlPageStats *stats);
+
+private:
+
+  FILE *f;
+  GString *docName;
+};
+
+#endif
@@ -0,0 +1,233 @@
+//========================================================================
+//
+// HtmlWorkers.cc
+//
+//========================================================================
+
+#include <aconf.h>
+#include <stdio.h>
+#include "gmem.h"
+#include "GString.h"
+#include "PDFDoc.h"
+#include "HtmlOutputDev.h"
+#include "HtmlBackground.h"
+#include "HtmlCheckpoint.h"
+#include "HtmlErrors.h"
+#include "HtmlWorkers.h"
+
+//------------------------------------------------------------------------
+// HtmlPageWorkers
+//------------------------------------------------------------------------
+
+HtmlPageWorkers::HtmlPageWorkers(PDFDoc *docA, HtmlOutputDev *outA,
+				 HtmlParams *paramsA, GString *fileNameA,
+				 GString *extensionA, GBool rawOrderA,
+				 int nThreadsA) {
+  doc = docA;
+  out = outA;
+  params = paramsA;
+  fileName = fileNameA->copy();
+  extension = extensionA->copy();
+  rawOrder = rawOrderA;
+  nThreads = nThreadsA < 1 ? 1 : nThreadsA;
+  // keep the number of finished-but-unwritten pages bounded
+  window = 2 * nThreads;
+  done = NULL;
+  finished = NULL;
+  threads = NULL;
+  gInitMutex(&mutex);
+  gInitCondition(&cond);
+  gInitCondition(&finishCond);
+}
+
+HtmlPageWorkers::~HtmlPageWorkers() {
+  delete fileName;
+  delete extension;
+  gDestroyCondition(&cond);
+  gDestroyCondition(&finishCond);
+  gDestroyMutex(&mutex);
+}
+
+void HtmlPageWorkers::run(int firstPageA, int lastPageA,
+			  double hDPIA, double vDPIA) {
+  HtmlPage *pg;
+  int n, i;
+
+  if (lastPageA < firstPageA) {
+    return;
+  }
+  firstPage = firstPageA;
+  lastPage = lastPageA;
+  hDPI = hDPIA;
+  vDPI = vDPIA;
+  nextPage = firstPage;
+  nextOut = firstPage;
+  n = lastPage - firstPage + 1;
+  done = (HtmlPage **)gmallocn(n, sizeof(HtmlPage *));
+  finished = (GBool *)gmallocn(n, sizeof(GBool));
+  for (i = 0; i < n; ++i) {
+    done[i] = NULL;
+    finished[i] = gFalse;
+  }
+
+  threads = (GThreadID *)gmallocn(nThreads, sizeof(GThreadID));
+  for (i = 0; i < nThreads; ++i) {
+    gCreateThread(&threads[i], &threadFunc, this);
+  }
+
+  // write the pages in order as they become available
+  for (i = 0; i < n; ++i) {
+    gLockMutex(&mutex);
+    while (!finished[i]) {
+      gWaitCondition(&finishCond, &mutex);
+    }
+    gClearCondition(&finishCond);
+    pg = done[i];
+    done[i] = NULL;
+    nextOut = firstPage + i + 1;
+    gSignalCondition(&cond);
+    gUnlockMutex(&mutex);
+    if (pg) {
+      out->writePage(pg, firstPage + i);
+      delete pg;
+    }
+  }
+
+  for (i = 0; i < nThreads; ++i) {
+    gJoinThread(threads[i]);
+  }
+  gfree(threads);
+  threads = NULL;
+  gfree(done);
+  gfree(finished);
+  done = NULL;
+  finished = NULL;
+}
+
+GThreadReturn HtmlPageWorkers::threadFunc(void *arg) {
+  ((HtmlPageWorkers *)arg)->worker();
+  return 0;
+}
+
+void HtmlPageWorkers::worker() {
+  HtmlErrorScope errScope(params);
+  HtmlOutputDev *dev;
+  HtmlPage *pg;
+  int pageNum;
+
+  dev = new HtmlOutputDev(params, fileName->getCString(),
+			  extension->getCString(), rawOrder);
+  while (1) {
+    gLockMutex(&mutex);
+    while (nextPage <= lastPage && nextPage >= nextOut + window) {
+      gWaitCondition(&cond, &mutex);
+    }
+    gClearCondition(&cond);
+    if (nextPage > lastPage) {
+      gUnlockMutex(&mutex);
+      break;
+    }
+    pageNum = nextPage++;
+    gUnlockMutex(&mutex);
+
+    doc->displayPage(dev, pageNum, hDPI, vDPI, 0, gTrue, gTrue, gTrue,
+		     (params->pageTimeout > 0 || params->pageMem > 0)
+		       ? &HtmlOutputDev::abortCheck : NULL,
+		     dev);
+    pg = dev->takePage();
+
+    gLockMutex(&mutex);
+    done[pageNum - firstPage] = pg;
+    finished[pageNum - firstPage] = gTrue;
+    gSignalCondition(&finishCond);
+    gUnlockMutex(&mutex);
+  }
+  delete dev;
+}
+
+//------------------------------------------------------------------------
+// HtmlBackgroundWorkers
+//------------------------------------------------------------------------
+
+HtmlBackgroundWorkers::HtmlBackgroundWorkers(PDFDoc *docA,
+					     GString *fileNameA,
+					     double dpiA, GBool grayA,
+					     int timeoutA,
+					     HtmlCheckpoint *ckptA,
+					     int nThreadsA) {
+  doc = docA;
+  fileName = fileNameA->copy();
+  dpi = dpiA;
+  gray = grayA;
+  timeout = timeoutA;
+  ckpt = ckptA;
+  nThreads = nThreadsA < 1 ? 1 : nThreadsA;
+  errParams = getHtmlErrorParams();
+  threads = NULL;
+  gInitMutex(&mutex);
+}
+
+HtmlBackgroundWorkers::~HtmlBackgroundWorkers() {
+  finish();
+  delete fileName;
+  gDestroyMutex(&mutex);
+}
+
+void HtmlBackgroundWorkers::start(int firstPageA, int lastPageA) {
+  int i;
+
+  firstPage = firstPageA;
+  lastPage = lastPageA;
+  nextPage = firstPage;
+  threads = (GThreadID *)gmallocn(nThreads, sizeof(GThreadID));
+  for (i = 0; i < nThreads; ++i) {
+    gCreateThread(&threads[i], &threadFunc, this);
+  }
+}
+
+void HtmlBackgroundWorkers::finish() {
+  int i;
+
+  if (!threads) {
+    return;
+  }
+  for (i = 0; i < nThreads; ++i) {
+    gJoinThread(threads[i]);
+  }
+  gfree(threads);
+  threads = NULL;
+}
+
+GThreadReturn HtmlBackgroundWorkers::threadFunc(void *arg) {
+  ((HtmlBackgroundWorkers *)arg)->worker();
+  return 0;
+}
+
+void HtmlBackgroundWorkers::worker() {
+  HtmlErrorScope errScope(errParams);
+  HtmlBackground *bg;
+  GString *imgFileName;
+  int pageNum;
+
+  bg = new HtmlBackground(doc, dpi, gray, timeout);
+  while (1) {
+    gLockMutex(&mutex);
+    if (nextPage > lastPage) {
+      gUnlockMutex(&mutex);
+      break;
+    }
+    pageNum = nextPage++;
+    gUnlockMutex(&mutex);
+
+    if (ckpt && ckpt->hasBackground(pageNum)) {
+      continue;
+    }
+    imgFileName = GString::format("{0:t}{1:03d}.png", fileName,
+				  pageNum - firstPage + 1);
+    if (bg->renderPage(pageNum, imgFileName) && ckpt) {
+      ckpt->backgroundDone(pageNum, imgFileName);
+    }
+    delete imgFileName;
+  }
+  delete bg;
+}
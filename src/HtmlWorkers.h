@@ -0,0 +1,116 @@
+//========================================================================
+//
+// HtmlWorkers.h
+//
+// Page-parallel conversion: worker threads interpret pages on their
+// own HtmlOutputDev, the main device writes them in page order.  The
+// -c background images are rendered by a separate pool.
+//
+//========================================================================
+
+#ifndef HTMLWORKERS_H
+#define HTMLWORKERS_H
+
+#include "gtypes.h"
+#include "GThread.h"
+
+class PDFDoc;
+class GString;
+class HtmlPage;
+class HtmlParams;
+class HtmlOutputDev;
+class HtmlBackground;
+class HtmlCheckpoint;
+
+//------------------------------------------------------------------------
+// HtmlPageWorkers
+//------------------------------------------------------------------------
+
+class HtmlPageWorkers {
+public:
+
+  // <out> is the main device; the workers create their own devices
+  // with the same <params>, <fileName>, <extension> and <rawOrder>.
+  HtmlPageWorkers(PDFDoc *docA, HtmlOutputDev *outA, HtmlParams *paramsA,
+		  GString *fileNameA, GString *extensionA, GBool rawOrderA,
+		  int nThreadsA);
+  ~HtmlPageWorkers();
+
+  // Convert pages <firstPage> .. <lastPage> and write them to the
+  // main device.  Returns when all pages have been written.
+  void run(int firstPageA, int lastPageA, double hDPIA, double vDPIA);
+
+private:
+
+  static GThreadReturn threadFunc(void *arg);
+  void worker();
+
+  PDFDoc *doc;
+  HtmlOutputDev *out;
+  HtmlParams *params;
+  GString *fileName;
+  GString *extension;
+  GBool rawOrder;
+  int nThreads;
+  int window;			// max number of pages ahead of the writer
+
+  int firstPage, lastPage;
+  double hDPI, vDPI;
+  int nextPage;			// next page to be taken by a worker
+  int nextOut;			// next page to be written
+  HtmlPage **done;		// finished pages, indexed by page - firstPage
+  GBool *finished;		// set when done[i] is valid (may be NULL)
+
+  GThreadID *threads;
+  GMutex mutex;
+  GCondition cond;		// signalled when the writer moves on
+  GCondition finishCond;	// signalled when a worker finishes a page
+};
+
+//------------------------------------------------------------------------
+// HtmlBackgroundWorkers
+//------------------------------------------------------------------------
+
+class HtmlBackgroundWorkers {
+public:
+
+  // Each worker renders with its own HtmlBackground (<dpiA>, <grayA>,
+  // <timeoutA>), into <fileNameA> followed by the page number (counted
+  // from the first page) and ".png".  Pages that <ckptA> (if not NULL)
+  // has a background for are skipped, and the others are recorded in
+  // it.  The workers' error messages follow the conversion of the
+  // thread that creates them (HtmlErrors.h).
+  HtmlBackgroundWorkers(PDFDoc *docA, GString *fileNameA, double dpiA,
+			GBool grayA, int timeoutA, HtmlCheckpoint *ckptA,
+			int nThreadsA);
+  ~HtmlBackgroundWorkers();
+
+  // Start rendering pages <firstPage> .. <lastPage> and return; the
+  // images are written in whatever order the workers finish them.
+  void start(int firstPageA, int lastPageA);
+
+  // Wait until all pages have been written.
+  void finish();
+
+private:
+
+  static GThreadReturn threadFunc(void *arg);
+  void worker();
+
+  PDFDoc *doc;
+  GString *fileName;
+  double dpi;
+  GBool gray;
+  int timeout;
+  HtmlCheckpoint *ckpt;
+  int nThreads;
+  HtmlParams *errParams;	// for the error messages
+
+  int firstPage, lastPage;
+  int nextPage;			// next page to be taken by a worker
+
+  GThreadID *threads;
+  GMutex mutex;
+};
+
+#endif
@@ -0,0 +1,200 @@
+//========================================================================
+//
+// HtmlWriter.cc
+//
+//========================================================================
+
+#include <aconf.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include "gmem.h"
+#include "GString.h"
+#include "HtmlWriter.h"
+
+// Large enough to hold a typical page, so that a page is normally
+// written with a single call.
+#define htmlWriterBufSize (256 * 1024)
+
+//------------------------------------------------------------------------
+// HtmlWriter
+//------------------------------------------------------------------------
+
+HtmlWriter::HtmlWriter(FILE *fA) {
+  f = fA;
+  size = htmlWriterBufSize;
+  buf = (char *)gmalloc(size);
+  len = 0;
+  written = 0;
+}
+
+HtmlWriter::~HtmlWriter() {
+  flush();
+  gfree(buf);
+}
+
+void HtmlWriter::flushBuf() {
+  if (len > 0) {
+    fwrite(buf, 1, len, f);
+    written += len;
+    len = 0;
+  }
+}
+
+void HtmlWriter::flush() {
+  flushBuf();
+}
+
+void HtmlWriter::put(const char *s, int n) {
+  if (n > size - len) {
+    flushBuf();
+    if (n > size) {
+      fwrite(s, 1, n, f);
+      written += n;
+      return;
+    }
+  }
+  memcpy(buf + len, s, n);
+  len += n;
+}
+
+void HtmlWriter::put(GString *s) {
+  put(s->getCString(), s->getLength());
+}
+
+void HtmlWriter::putInt(int x) {
+  char tmp[16];
+  char *p;
+  unsigned int u;
+
+  p = tmp + sizeof(tmp);
+  u = x < 0 ? -(unsigned int)x : (unsigned int)x;
+  do {
+    *--p = (char)('0' + u % 10);
+    u /= 10;
+  } while (u);
+  if (x < 0) {
+    *--p = '-';
+  }
+  put(p, (int)(tmp + sizeof(tmp) - p));
+}
+
+void HtmlWriter::putDouble(double x, int prec) {
+  int n;
+
+  if (size - len < 64) {
+    flushBuf();
+  }
+  if ((n = GString::formatFixed(x, buf + len, size - len, prec)) < 0) {
+    printf("%.*f", prec, x);
+    return;
+  }
+  len += n;
+}
+
+void HtmlWriter::putU32(unsigned int x) {
+  char b[4];
+
+  b[0] = (char)x;
+  b[1] = (char)(x >> 8);
+  b[2] = (char)(x >> 16);
+  b[3] = (char)(x >> 24);
+  put(b, 4);
+}
+
+void HtmlWriter::putF64(double x) {
+  unsigned long long u;
+  char b[8];
+  int i;
+
+  // doubles have the byte order of the integers on all the hosts we
+  // build on
+  memcpy(&u, &x, 8);
+  for (i = 0; i < 8; ++i) {
+    b[i] = (char)(u >> (8 * i));
+  }
+  put(b, 8);
+}
+
+void HtmlWriter::putZeros(int n) {
+  static const char zeros[16] = { 0 };
+
+  for (; n > 16; n -= 16) {
+    put(zeros, 16);
+  }
+  put(zeros, n);
+}
+
+void HtmlWriter::printf(const char *fmt, ...) {
+  va_list args;
+  char tmp[512];
+  char *big;
+  int n;
+
+  va_start(args, fmt);
+  n = vsnprintf(tmp, sizeof(tmp), fmt, args);
+  va_end(args);
+  if (n < 0) {
+    return;
+  }
+  if (n < (int)sizeof(tmp)) {
+    put(tmp, n);
+    return;
+  }
+  big = (char *)gmalloc(n + 1);
+  va_start(args, fmt);
+  vsnprintf(big, n + 1, fmt, args);
+  va_end(args);
+  put(big, n);
+  gfree(big);
+}
+
+void HtmlWriter::putXMLText(const char *s) {
+  const char *p;
+
+  // copy runs of ordinary characters in one go
+  for (p = s; ; ++p) {
+    switch (*p) {
+    case '\0':
+      put(s, (int)(p - s));
+      return;
+    case '&':
+      put(s, (int)(p + 1 - s));
+      put("amp;", 4);
+      s = p + 1;
+      break;
+    case '\r':
+      put(s, (int)(p - s));
+      put('\n');
+      s = p + 1;
+      break;
+    case '\f':
+      put(s, (int)(p - s));
+      s = p + 1;
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+void HtmlWriter::putXMLAttr(const char *s) {
+  const char *p;
+  const char *ent;
+
+  for (p = s; ; ++p) {
+    switch (*p) {
+    case '\0':
+      put(s, (int)(p - s));
+      return;
+    case '&': ent = "amp;"; break;
+    case '<': ent = "&lt;"; break;
+    case '>': ent = "&gt;"; break;
+    case '"': ent = "&quot;"; break;
+    default: continue;
+    }
+    put(s, (int)(p - s));
+    put(ent);
+    s = p + 1;
+  }
+}
@@ -0,0 +1,83 @@
+//========================================================================
+//
+// HtmlWriter.h
+//
+// Buffered output for the page dump routines.  Text is collected in a
+// user-space buffer and handed to stdio in large blocks, instead of one
+// fprintf call per character or attribute.
+//
+//========================================================================
+
+#ifndef HTMLWRITER_H
+#define HTMLWRITER_H
+
+#include <stdio.h>
+#include <string.h>
+#include "gtypes.h"
+
+class GString;
+
+//------------------------------------------------------------------------
+// HtmlWriter
+//------------------------------------------------------------------------
+
+class HtmlWriter {
+public:
+
+  // Write to <fA>.  The file is not closed by the writer.
+  HtmlWriter(FILE *fA);
+
+  // Flushes the buffer.
+  ~HtmlWriter();
+
+  FILE *getFile() { return f; }
+
+  void put(char c)
+    { if (len == size) flushBuf(); buf[len++] = c; }
+  void put(const char *s, int n);
+  void put(const char *s) { put(s, (int)strlen(s)); }
+  void put(GString *s);
+
+  // Decimal integer.
+  void putInt(int x);
+
+  // Fixed-point with <prec> digits after the decimal point, the same
+  // text as printf("%.<prec>f").
+  void putDouble(double x, int prec);
+
+  // printf-style formatting, for the rarely used elements.
+  void printf(const char *fmt, ...);
+
+  // Text content of an XML element: '&' is written as "&amp;", '\r'
+  // as '\n', and '\f' is dropped.  Other characters are copied
+  // unchanged (the strings have already been through the font's
+  // entity conversion).
+  void putXMLText(const char *s);
+
+  // Attribute value: '<', '>' and '"' become entities.  '&' is written
+  // as "amp;", as writeURL() always did.
+  void putXMLAttr(const char *s);
+
+  // Binary output, little-endian whatever the host byte order.
+  void putU32(unsigned int x);
+  void putF64(double x);
+  void putZeros(int n);
+
+  // Pass the buffered text to stdio.
+  void flush();
+
+  // Bytes written so far, including those still in the buffer.
+  double getBytesWritten() { return written + len; }
+
+private:
+
+  void flushBuf();
+
+  FILE *f;
+  char *buf;
+  int len;			// number of bytes in buf
+  int size;			// allocated size of buf
+  double written;		// bytes passed to stdio
+};
+
+#endif
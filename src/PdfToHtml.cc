@@ -0,0 +1,113 @@
+//========================================================================
+//
+// PdfToHtml.cc
+//
+// The C interface (PdfToHtml.h) over HtmlConverter.
+//
+//========================================================================
+
+#include <aconf.h>
+#include <string.h>
+#include "gmem.h"
+#include "ErrorCodes.h"
+#include "HtmlParams.h"
+#include "HtmlConverter.h"
+#include "PdfToHtml.h"
+
+struct PdfToHtml {
+  HtmlConverter *conv;
+};
+
+void pdfToHtmlInitOptions(PdfToHtmlOptions *opts) {
+  HtmlParams params;
+
+  memset(opts, 0, sizeof(*opts));
+  opts->format = pdfToHtmlFormatXML;
+  opts->firstPage = params.firstPage;
+  opts->lastPage = params.lastPage;
+  opts->nThreads = params.nThreads;
+  opts->zoom = params.scale;
+  opts->precision = params.coordPrecision;
+  opts->quiet = 1;
+}
+
+PdfToHtml *pdfToHtmlNew(const PdfToHtmlOptions *opts) {
+  HtmlParams params;
+  PdfToHtml *conv;
+
+  switch (opts->format) {
+  case pdfToHtmlFormatHTML:
+    params.noframes = gTrue;
+    break;
+  case pdfToHtmlFormatXML:
+    params.xml = gTrue;
+    params.stream = opts->stream ? gTrue : gFalse;
+    break;
+  case pdfToHtmlFormatJSONL:
+    params.jsonl = gTrue;
+    break;
+  case pdfToHtmlFormatBinary:
+    params.binary = gTrue;
+    break;
+  default:
+    return NULL;
+  }
+  params.firstPage = opts->firstPage;
+  params.lastPage = opts->lastPage;
+  params.nThreads = opts->nThreads;
+  params.scale = opts->zoom;
+  params.showHidden = opts->hidden ? gTrue : gFalse;
+  params.outputPaths = opts->paths ? gTrue : gFalse;
+  params.outputImages = opts->images ? gTrue : gFalse;
+  params.coordPrecision = opts->precision;
+  params.pathTolerance = opts->simplify;
+  params.maxPathPoints = opts->maxPoints;
+  params.pageTimeout = opts->pageTimeout;
+  params.pageMem = opts->pageMem;
+  params.forceCopy = opts->force ? gTrue : gFalse;
+  params.quiet = opts->quiet ? gTrue : gFalse;
+  params.errorFunc = opts->errorFunc;
+  params.errorData = opts->errorData;
+  params.textEncName = (char *)opts->textEncoding;
+  params.ownerPassword = (char *)opts->ownerPassword;
+  params.userPassword = (char *)opts->userPassword;
+
+  conv = (PdfToHtml *)gmalloc(sizeof(PdfToHtml));
+  conv->conv = new HtmlConverter(&params);
+  if (!conv->conv->isOk()) {
+    pdfToHtmlFree(conv);
+    return NULL;
+  }
+  return conv;
+}
+
+void pdfToHtmlFree(PdfToHtml *conv) {
+  delete conv->conv;
+  gfree(conv);
+}
+
+int pdfToHtmlConvertData(PdfToHtml *conv, const char *buf, size_t len,
+			 const char *outFileName,
+			 PdfToHtmlOutputFunc outFunc, void *outData,
+			 int *nPages) {
+  // MemStream lengths are 32 bits
+  if (len > 0xffffffffU) {
+    if (nPages) {
+      *nPages = 0;
+    }
+    return errOpenFile;
+  }
+  return conv->conv->convertData((char *)buf, (Guint)len,
+				 (char *)outFileName, outFunc, outData,
+				 nPages);
+}
+
+int pdfToHtmlConvertFile(PdfToHtml *conv, const char *pdfFileName,
+			 const char *outFileName, int *nPages) {
+  return conv->conv->convertFile((char *)pdfFileName, (char *)outFileName,
+				 nPages);
+}
+
+const char *pdfToHtmlErrorString(int errCode) {
+  return HtmlConverter::getErrorString(errCode);
+}
@@ -0,0 +1,101 @@
+/*========================================================================
+ *
+ * PdfToHtml.h
+ *
+ * C interface of libpdftohtml.a, for programs (and other languages'
+ * foreign function interfaces) that convert documents without running
+ * the pdftohtml command.  A converter holds its own settings; several
+ * can be used in one process, but each one converts one document at a
+ * time.  This header is plain C.
+ *
+ * The options are those of the command line tool.  The output goes to
+ * a callback, piece by piece as it is written: the document header
+ * (page 0), each page, and the trailer (page 0 again).
+ *
+ *========================================================================*/
+
+#ifndef PDFTOHTML_H
+#define PDFTOHTML_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Receives an error message; <category> is an xpdf ErrorCategory, and
+ * <pos> the position in the file (or -1). */
+typedef void (*PdfToHtmlErrorFunc)(void *data, int category, int pos,
+				   const char *msg);
+
+/* PdfToHtmlOptions.format */
+#define pdfToHtmlFormatHTML 0		/* -noframes */
+#define pdfToHtmlFormatXML 1		/* -xml */
+#define pdfToHtmlFormatJSONL 2		/* -jsonl */
+#define pdfToHtmlFormatBinary 3		/* -binary, see HtmlBinary.h */
+
+typedef struct {
+  int format;			/* pdfToHtmlFormat... */
+  int firstPage;		/* -f */
+  int lastPage;			/* -l (0 = the last page) */
+  int nThreads;			/* -j */
+  double zoom;			/* -zoom */
+  int stream;			/* -stream (with pdfToHtmlFormatXML) */
+  int hidden;			/* -hidden */
+  int paths;			/* -paths */
+  int images;			/* -images */
+  int precision;		/* -precision */
+  double simplify;		/* -simplify */
+  int maxPoints;		/* -maxpoints */
+  int pageTimeout;		/* -page-timeout, milliseconds */
+  int pageMem;			/* -page-mem, megabytes */
+  int force;			/* -force */
+  int quiet;			/* -q */
+  PdfToHtmlErrorFunc errorFunc;	/* receives this converter's error
+				 * messages, even if quiet (or NULL) */
+  void *errorData;
+  const char *textEncoding;	/* -enc (or NULL) */
+  const char *ownerPassword;	/* -opw (or NULL) */
+  const char *userPassword;	/* -upw (or NULL) */
+} PdfToHtmlOptions;
+
+typedef struct PdfToHtml PdfToHtml;
+
+/* Receives <len> bytes of the output of page <pageNum> (0 for the
+ * document header and trailer). */
+typedef void (*PdfToHtmlOutputFunc)(void *data, int pageNum,
+				    const char *buf, int len);
+
+/* Set <opts> to the command line defaults (quiet, though). */
+void pdfToHtmlInitOptions(PdfToHtmlOptions *opts);
+
+/* A converter with <opts>, which are copied.  Returns NULL if the text
+ * encoding is unknown. */
+PdfToHtml *pdfToHtmlNew(const PdfToHtmlOptions *opts);
+
+void pdfToHtmlFree(PdfToHtml *conv);
+
+/* Convert the PDF file in <buf> (<len> bytes), passing the output to
+ * <outFunc>.  Image files (for <opts.images>) are written, with names
+ * starting with <outFileName> (NULL = "pdftohtml").  The XML header
+ * has no <filename>, and <len> as the <filesize>.  Returns 0 on
+ * success or an xpdf error code, and sets *<nPages> (if not NULL) to
+ * the number of pages converted. */
+int pdfToHtmlConvertData(PdfToHtml *conv, const char *buf, size_t len,
+			 const char *outFileName,
+			 PdfToHtmlOutputFunc outFunc, void *outData,
+			 int *nPages);
+
+/* Convert the file <pdfFileName> to files, as the command line tool
+ * does. */
+int pdfToHtmlConvertFile(PdfToHtml *conv, const char *pdfFileName,
+			 const char *outFileName, int *nPages);
+
+/* Message for an error code returned by the conversion functions. */
+const char *pdfToHtmlErrorString(int errCode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
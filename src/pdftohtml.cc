@@ -11,44 +11,22 @@
 #include <stddef.h>
 #include <string.h>
 #include <aconf.h>
-#include <time.h>
 #include "parseargs.h"
 #include "GString.h"
 #include "gmem.h"
 #include "Object.h"
-#include "Stream.h"
-#include "Array.h"
-#include "Dict.h"
-#include "XRef.h"
-#include "Catalog.h"
-#include "Page.h"
-#include "PDFDoc.h"
-#include "HtmlOutputDev.h"
-#include "PSOutputDev.h"
+#include "HtmlParams.h"
+#include "HtmlConverter.h"
+#include "HtmlStats.h"
 #include "GlobalParams.h"
 #include "Error.h"
+#include "ErrorCodes.h"
 #include "config.h"
-#include "gfile.h"
 
-static int firstPage = 1;
-static int lastPage = 0;
-static GBool rawOrder = gTrue;
-GBool printCommands = gTrue;
 static GBool printHelp = gFalse;
-GBool printHtml = gFalse;
-GBool complexMode=gFalse;
-GBool ignore=gFalse;
-//char extension[5]=".png";
-double scale=1.5;
-GBool noframes=gFalse;
-GBool stout=gFalse;
-GBool xml=gFalse;
-GBool errQuiet=gFalse;
 
-GBool showHidden = gFalse;
-GBool noMerge = gTrue;
-
-GBool forceCopy = gFalse;
+// settings for the converter
+static HtmlParams params;
 
 
 static char ownerPassword[33] = "";
@@ -56,78 +34,96 @@ static char userPassword[33] = "";
 static char gsDevice[33] = "png16m";
 static GBool printVersion = gFalse;
 
-static GString* getInfoString(Dict *infoDict, char *key);
-static GString* getInfoDate(Dict *infoDict, char *key);
+static void convertBatch(HtmlConverter *conv, char *manifest, char *log);
+static GString *readLine(FILE *f);
 
 static char textEncName[128] = "";
+static char batchFile[256] = "";
+static char batchLogFile[256] = "";
+static char statsFile[256] = "";
 
 static ArgDesc argDesc[] = {
-  {"-f",      argInt,      &firstPage,     0,
+  {"-f",      argInt,      &params.firstPage,     0,
    "first page to convert"},
-  {"-l",      argInt,      &lastPage,      0,
+  {"-l",      argInt,      &params.lastPage,      0,
    "last page to convert"},
+  {"-j",      argInt,      &params.nThreads,      0,
+   "number of pages to convert in parallel"},
   /*{"-raw",    argFlag,     &rawOrder,      0,
     "keep strings in content stream order"},*/
-  {"-q",      argFlag,     &errQuiet,      0,
+  {"-q",      argFlag,     &params.quiet,      0,
    "don't print any messages or errors"},
   {"-h",      argFlag,     &printHelp,     0,
    "print usage information"},
   {"-help",   argFlag,     &printHelp,     0,
    "print usage information"},
-  {"-p",      argFlag,     &printHtml,     0,
+  {"-p",      argFlag,     &params.printHtml,     0,
    "exchange .pdf links by .html"}, 
-  {"-c",      argFlag,     &complexMode,          0,
+  {"-c",      argFlag,     &params.complexMode,          0,
    "generate complex document"},
-  {"-i",      argFlag,     &ignore,        0,
+  {"-i",      argFlag,     &params.ignore,        0,
    "ignore images"},
-  {"-noframes", argFlag,   &noframes,      0,
+  {"-noframes", argFlag,   &params.noframes,      0,
    "generate no frames"},
-  {"-stdout"  ,argFlag,    &stout,         0,
+  {"-stdout"  ,argFlag,    &params.stout,         0,
    "use standard output"},
-  {"-zoom",   argFP,    &scale,         0,
+  {"-zoom",   argFP,    &params.scale,         0,
    "zoom the pdf document (default 1.5)"},
-  {"-xml",    argFlag,    &xml,         0,
+  {"-xml",    argFlag,    &params.xml,         0,
    "output for XML post-processing"},
-  {"-hidden", argFlag,   &showHidden,   0,
+  {"-binary", argFlag,   &params.binary,       0,
+   "write the -xml data in the binary layout of HtmlBinary.h"},
+  {"-jsonl",  argFlag,   &params.jsonl,        0,
+   "write one JSON object per page (JSON Lines)"},
+  {"-stream", argFlag,   &params.stream,       0,
+   "write the -xml text as it is drawn, in content stream order, without holding the page in memory"},
+  {"-hidden", argFlag,   &params.showHidden,   0,
    "output hidden text"},
-/*  {"-nomerge", argFlag, &noMerge, 0,
+/*  {"-nomerge", argFlag, &params.noMerge, 0,
    "do not merge paragraphs"}, */  
   {"-enc",    argString,   textEncName,    sizeof(textEncName),
    "output text encoding name"},
   {"-dev",    argString,   gsDevice,       sizeof(gsDevice),
-   "output device name for Ghostscript (png16m, jpeg etc)"},
+   "background image type: png16m, pnggray (rendered directly) or another Ghostscript device (jpeg etc)"},
   {"-v",      argFlag,     &printVersion,  0,
    "print copyright and version info"},
   {"-opw",    argString,   ownerPassword,  sizeof(ownerPassword),
    "owner password (for encrypted files)"},
   {"-upw",    argString,   userPassword,   sizeof(userPassword),
    "user password (for encrypted files)"},
-  {"-force", argFlag, &forceCopy, 0, "copy the text even if the document indicates we are not allowed"},
-  {"-coalesce", argFlag, &HtmlOutputDev::doCoalesce, 0, "combine the strings"},
-  {"-paths", argFlag, &HtmlOutputDev::outputPaths, 0, "include paths, rectangles, etc."},
-  {"-images", argFlag, &HtmlOutputDev::outputImages, 0, "include images"},
+  {"-force", argFlag, &params.forceCopy, 0, "copy the text even if the document indicates we are not allowed"},
+  {"-coalesce", argFlag, &params.doCoalesce, 0, "combine the strings"},
+  {"-paths", argFlag, &params.outputPaths, 0, "include paths, rectangles, etc. in the XML output"},
+  {"-images", argFlag, &params.outputImages, 0, "include images"},
+  {"-precision", argInt, &params.coordPrecision, 0,
+   "digits after the decimal point for XML coordinates (default 3)"},
+  {"-simplify", argFP, &params.pathTolerance, 0,
+   "simplify paths to within this distance (default 0 = off)"},
+  {"-maxpoints", argInt, &params.maxPathPoints, 0,
+   "maximum number of path points per page (default 0 = no limit)"},
+  {"-batch", argString, batchFile, sizeof(batchFile),
+   "convert the documents listed in this file (- for stdin)"},
+  {"-batchlog", argString, batchLogFile, sizeof(batchLogFile),
+   "write the -batch status lines to this file (default: stderr)"},
+  {"-page-timeout", argInt, &params.pageTimeout, 0,
+   "stop interpreting a page after this many milliseconds (default 0 = no limit)"},
+  {"-page-mem", argInt, &params.pageMem, 0,
+   "stop interpreting a page whose content takes this many MB (default 0 = no limit)"},
+  {"-checkpoint", argFlag, &params.checkpoint, 0,
+   "record each page written in <output>.ckpt, and resume an unfinished conversion from it"},
+  {"-stats", argString, statsFile, sizeof(statsFile),
+   "write per-page timings and counts to this file (JSON Lines, - for stderr)"},
   {NULL}
 };
 
 int main(int argc, char *argv[]) {
-  PDFDoc *doc = NULL;
-  GString *fileName = NULL;
-  GString *docTitle = NULL;
-  GString *author = NULL, *keywords = NULL, *subject = NULL, *date = NULL;
-  GString *htmlFileName = NULL;
-  GString *psFileName = NULL;
-  HtmlOutputDev *htmlOut = NULL;
-  PSOutputDev *psOut = NULL;
+  HtmlConverter *conv;
   GBool ok;
-  char *p;
-  char extension[16] = "png";
-  GString *ownerPW, *userPW;
-  Object info;
-  char * extsList[] = {"png", "jpeg", "bmp", "pcx", "tiff", "pbm", NULL};
 
   // parse args
   ok = parseArgs(argDesc, &argc, argv);
-  if (!ok || argc < 2 || argc > 3 || printHelp || printVersion) {
+  if (!ok || (batchFile[0] ? argc != 1 : (argc < 2 || argc > 3)) ||
+      printHelp || printVersion) {
     fprintf(stderr, "pdftohtml version %s http://pdftohtml.sourceforge.net/, based on Xpdf version %s\n", "0.40", xpdfVersion);
     fprintf(stderr, "%s\n", "Copyright 1999-2003 Gueorgui Ovtcharov and Rainer Dorsch");
     fprintf(stderr, "%s\n\n", xpdfCopyright);
@@ -136,253 +132,38 @@ int main(int argc, char *argv[]) {
     }
     exit(1);
   }
- 
-  // init error file
-  //errorInit();
-
-  // read config file
-  globalParams = new GlobalParams("");
-
-  if (errQuiet) {
-    globalParams->setErrQuiet(errQuiet);
-    printCommands = gFalse; // I'm not 100% what is the differecne between them
-  }
-
-  if (textEncName[0]) {
-    globalParams->setTextEncoding(textEncName);
-    if( !globalParams->getTextEncoding() )  {
-	goto error;    
-    }
+  if (batchFile[0] && params.stout) {
+    error(errCommandLine, -1, "-stdout can't be used with -batch");
+    exit(1);
   }
-
-  // open PDF file
+ 
   if (ownerPassword[0]) {
-    ownerPW = new GString(ownerPassword);
-  } else {
-    ownerPW = NULL;
+    params.ownerPassword = ownerPassword;
   }
   if (userPassword[0]) {
-    userPW = new GString(userPassword);
-  } else {
-    userPW = NULL;
-  }
-
-  fileName = new GString(argv[1]);
-
-  doc = new PDFDoc(fileName, ownerPW, userPW);
-  if (userPW) {
-    delete userPW;
-  }
-  if (ownerPW) {
-    delete ownerPW;
+    params.userPassword = userPassword;
   }
-  if (!doc->isOk()) {
-    goto error;
+  if (textEncName[0]) {
+    params.textEncName = textEncName;
   }
+  params.gsDevice = gsDevice;
 
-  // check for copy permission
-  if (!doc->okToCopy() && !forceCopy) {
-    error(errNotAllowed, 0, "Copying of text from this document is not allowed.");
-    goto error;
+  conv = new HtmlConverter(&params);
+  if (statsFile[0]) {
+    conv->getParams()->stats = new HtmlStatsFile(statsFile);
   }
-
-  // construct text file name
-  if (argc == 3) {
-    GString* tmp = new GString(argv[2]);
-    p = tmp->getCString() ;
-    int len = tmp->getLength();
-    if (!xml) {
-      if(len > 5)
-        p = p + len - 5;          
-      if (len > 5 && (!strcmp(p, ".html") || !strcmp(p, ".HTML")))
-	htmlFileName = new GString(tmp->getCString(),
-				   tmp->getLength() - 5);
-      else htmlFileName =new GString(tmp);
+  if (conv->isOk()) {
+    if (batchFile[0]) {
+      convertBatch(conv, batchFile, batchLogFile[0] ? batchLogFile : NULL);
     } else {
-      if(len > 4)
-        p = p + len - 4;                  
-      if (len > 4 && (!strcmp(p, ".xml") || !strcmp(p, ".XML")))
-	htmlFileName = new GString(tmp->getCString(),
-				   tmp->getLength() - 4);
-      else htmlFileName =new GString(tmp);
+      conv->convertFile(argv[1], argc == 3 ? argv[2] : NULL, NULL);
     }
-    
-    delete tmp;
-  } else {
-    p = fileName->getCString() + fileName->getLength() - 4;
-    if (!strcmp(p, ".pdf") || !strcmp(p, ".PDF"))
-      htmlFileName = new GString(fileName->getCString(),
-				 fileName->getLength() - 4);
-    else
-      htmlFileName = fileName->copy();
-    //   htmlFileName->append(".html");
-  }
-  
-   if (scale>3.0) scale=3.0;
-   if (scale<0.5) scale=0.5;
-   
-   if (complexMode) {
-     //noframes=gFalse;
-     stout=gFalse;
-   } 
-
-   if (stout) {
-     noframes=gTrue;
-     complexMode=gFalse;
-   }
-
-   if (xml)
-   { 
-       complexMode = gTrue;
-       noframes = gTrue;
-       noMerge = gTrue;
-   }
-
-  // get page range
-  if (firstPage < 1)
-    firstPage = 1;
-  if (lastPage < 1 || lastPage > doc->getNumPages())
-    lastPage = doc->getNumPages();
-
-  doc->getDocInfo(&info);
-  if (info.isDict()) {
-      docTitle = getInfoString(info.getDict(), "Title");
-      author = getInfoString(info.getDict(), "Author");
-      keywords = getInfoString(info.getDict(), "Keywords");
-      subject = getInfoString(info.getDict(), "Subject");
-      date = getInfoDate(info.getDict(), "ModDate");
-      if( !date )
-          date = getInfoDate(info.getDict(), "CreationDate");
-  }
-  if( !docTitle ) docTitle = new GString(htmlFileName);
-
-  /* determine extensions of output background images */
-  {int i;
-  for(i = 0; extsList[i]; i++)
-  {
-	  if( strstr(gsDevice, extsList[i]) != (char *) NULL )
-	  {
-		  strncpy(extension, extsList[i], sizeof(extension));
-		  break;
-	  }
-  }}
-
-  rawOrder = complexMode; // todo: figure out what exactly rawOrder do :)
-
-  // write text file
-  htmlOut = new HtmlOutputDev(argv[1], htmlFileName->getCString(), 
-	  docTitle->getCString(), 
-	  author ? author->getCString() : NULL,
-	  keywords ? keywords->getCString() : NULL, 
-          subject ? subject->getCString() : NULL, 
-	  date ? date->getCString() : NULL,
-	  extension,
-	  rawOrder, 
-	  firstPage,
-          doc->getCatalog()->getOutline()->isDict(), info.isDict() ? info.getDict() : NULL);
-
-  info.free();  
-  delete docTitle;
-  if( author )
-  {   
-      delete author;
-  }
-  if( keywords )
-  {
-      delete keywords;
   }
-  if( subject )
-  {
-      delete subject;
+  if (conv->getParams()->stats) {
+    delete conv->getParams()->stats;
   }
-  if( date )
-  {
-      delete date;
-  }
-
-  if (htmlOut->isOk())
-  {
-//	doc->displayPages(htmlOut, firstPage, lastPage, static_cast<int>(72*scale), static_cast<int>(72*scale), 0, gTrue, gTrue);
-	doc->displayPages(htmlOut, firstPage, lastPage, static_cast<int>(72*scale), static_cast<int>(72*scale), 0, gTrue, gTrue,gTrue,NULL);
-	if (!xml)
-	{
-		htmlOut->dumpDocOutline(doc->getCatalog());
-	}
-  }
-  
-  if( complexMode && !xml && !ignore ) {
-    int h=xoutRound(htmlOut->getPageHeight()/scale);
-    int w=xoutRound(htmlOut->getPageWidth()/scale);
-    //int h=xoutRound(doc->getPageHeight(1)/scale);
-    //int w=xoutRound(doc->getPageWidth(1)/scale);
-
-    psFileName = new GString(htmlFileName->getCString());
-    psFileName->append(".ps");
-
-    globalParams->setPSPaperWidth(w);
-    globalParams->setPSPaperHeight(h);
-#if OLD_VERSION                                
-    globalParams->setPSNoText(gTrue);
-#endif
-    
-    psOut = new PSOutputDev(psFileName->getCString(),
-#if OLD_VERSION                            
-                            doc->getXRef(),
-			    doc->getCatalog(),
-#else
-                            doc, 
-#endif                            
-                            firstPage, lastPage, psModePS);
-   // doc->displayPages(psOut, firstPage, lastPage, static_cast<int>(72*scale), static_cast<int>(72*scale), 0, gTrue, gTrue);
-	doc->displayPages(psOut, firstPage, lastPage, static_cast<int>(72*scale), static_cast<int>(72*scale), 0, gTrue, gTrue,gTrue,NULL);
-    delete psOut;
+  delete conv;
 
-    /*sprintf(buf, "%s -sDEVICE=png16m -dBATCH -dNOPROMPT -dNOPAUSE -r72 -sOutputFile=%s%%03d.png -g%dx%d -q %s", GHOSTSCRIPT, htmlFileName->getCString(), w, h,
-      psFileName->getCString());*/
-    
-    GString *gsCmd = new GString(GHOSTSCRIPT);
-    GString *tw, *th, *sc;
-    gsCmd->append(" -sDEVICE=");
-	gsCmd->append(gsDevice);
-	gsCmd->append(" -dBATCH -dNOPROMPT -dNOPAUSE -r");
-    sc = GString::fromInt(static_cast<int>(72*scale));
-    gsCmd->append(sc);
-    gsCmd->append(" -sOutputFile=");
-    gsCmd->append("\"");
-    gsCmd->append(htmlFileName);
-    gsCmd->append("%03d.");
-	gsCmd->append(extension);
-	gsCmd->append("\" -g");
-    tw = GString::fromInt(static_cast<int>(scale*w));
-    gsCmd->append(tw);
-    gsCmd->append("x");
-    th = GString::fromInt(static_cast<int>(scale*h));
-    gsCmd->append(th);
-    gsCmd->append(" -q \"");
-    gsCmd->append(psFileName);
-    gsCmd->append("\"");
-//    printf("running: %s\n", gsCmd->getCString());
-    if( !executeCommand(gsCmd->getCString()) && !errQuiet) {
-       error(errCommandLine, 0, "Failed to launch Ghostscript!\n");
-    }
-    unlink(psFileName->getCString());
-    delete tw;
-    delete th;
-    delete sc;
-    delete gsCmd;
-    delete psFileName;
-  }
-  
-  delete htmlOut;
-
-  // clean up
- error:
-  if(doc) delete doc;
-  if(globalParams) delete globalParams;
-
-  if(htmlFileName) delete htmlFileName;
-  HtmlFont::clear();
-  
   // check for memory leaks
   Object::memCheck(stderr);
   gMemReport(stderr);
@@ -390,52 +171,87 @@ int main(int argc, char *argv[]) {
   return 0;
 }
 
-static GString* getInfoString(Dict *infoDict, char *key) {
-  Object obj;
-  GString *s1 = NULL;
-
-  if (infoDict->lookup(key, &obj)->isString()) {
-    s1 = new GString(obj.getString());
+// Convert each document listed in <manifest> ("-" for stdin) with the
+// same converter, so the font and CMap caches stay warm.  Each line
+// holds a PDF file name, optionally followed by a tab and the output
+// name; empty lines and lines starting with '#' are skipped.  A status
+// line is written to <log> (NULL for stderr) for every document, and a
+// document that fails does not stop the batch.  The status lines never
+// go to stdout, where the progress messages may go.
+static void convertBatch(HtmlConverter *conv, char *manifest, char *log) {
+  FILE *f, *logF;
+  GString *line;
+  char *pdfFileName, *outFileName, *p;
+  int errCode, nPages, n;
+
+  if (!strcmp(manifest, "-")) {
+    f = stdin;
+  } else if (!(f = fopen(manifest, "r"))) {
+    error(errIO, -1, "Couldn't open batch file '{0:s}'", manifest);
+    return;
   }
-  obj.free();
-  return s1;
-}
-
-static GString* getInfoDate(Dict *infoDict, char *key) {
-  Object obj;
-  char *s;
-  int year, mon, day, hour, min, sec;
-  struct tm tmStruct;
-  GString *result = NULL;
-  char buf[256];
-
-  if (infoDict->lookup(key, &obj)->isString()) {
-    s = obj.getString()->getCString();
-    if (s[0] == 'D' && s[1] == ':') {
-      s += 2;
+  if (!log) {
+    logF = stderr;
+  } else if (!(logF = fopen(log, "w"))) {
+    error(errIO, -1, "Couldn't open batch log file '{0:s}'", log);
+    if (f != stdin) {
+      fclose(f);
+    }
+    return;
+  }
+  while ((line = readLine(f))) {
+    n = line->getLength();
+    while (n > 0 && (line->getChar(n-1) == '\n' ||
+		     line->getChar(n-1) == '\r')) {
+      line->del(--n);
     }
-    if (sscanf(s, "%4d%2d%2d%2d%2d%2d",
-               &year, &mon, &day, &hour, &min, &sec) == 6) {
-      tmStruct.tm_year = year - 1900;
-      tmStruct.tm_mon = mon - 1;
-      tmStruct.tm_mday = day;
-      tmStruct.tm_hour = hour;
-      tmStruct.tm_min = min;
-      tmStruct.tm_sec = sec;
-      tmStruct.tm_wday = -1;
-      tmStruct.tm_yday = -1;
-      tmStruct.tm_isdst = -1;
-      mktime(&tmStruct); // compute the tm_wday and tm_yday fields
-      if (strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S+00:00", &tmStruct)) {
-	result = new GString(buf);
-      } else {
-        result = new GString(s);
+    if (n == 0 || line->getChar(0) == '#') {
+      delete line;
+      continue;
+    }
+    pdfFileName = line->getCString();
+    outFileName = NULL;
+    if ((p = strchr(pdfFileName, '\t'))) {
+      *p = '\0';
+      if (p[1]) {
+	outFileName = p + 1;
       }
+    }
+    errCode = conv->convertFile(pdfFileName, outFileName, &nPages);
+    if (errCode == errNone) {
+      fprintf(logF, "ok\t%s\t%d\n", pdfFileName, nPages);
     } else {
-      result = new GString(s);
+      fprintf(logF, "error\t%s\t%d\t%s\n", pdfFileName, errCode,
+	      HtmlConverter::getErrorString(errCode));
     }
+    fflush(logF);
+    delete line;
+  }
+  if (logF != stderr) {
+    fclose(logF);
+  }
+  if (f != stdin) {
+    fclose(f);
+  }
+}
+
+// Read a line of any length from <f>, with its newline (if any).
+// Returns NULL at the end of the file.
+static GString *readLine(FILE *f) {
+  GString *line;
+  int c;
+
+  line = new GString();
+  while ((c = fgetc(f)) != EOF) {
+    line->append((char)c);
+    if (c == '\n') {
+      break;
+    }
+  }
+  if (c == EOF && line->getLength() == 0) {
+    delete line;
+    return NULL;
   }
-  obj.free();
-  return result;
+  return line;
 }
 
@@ -42,6 +42,11 @@ void setErrorCallback(void (*cbk)(void *data, ErrorCategory category,
   errorCbkData = data;
 }
 
+void (*getErrorCallback())(void *data, ErrorCategory category,
+			   int pos, char *msg) {
+  return errorCbk;
+}
+
 void *getErrorCallbackData() {
   return errorCbkData;
 }
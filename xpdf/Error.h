@@ -40,6 +40,9 @@ extern void setErrorCallback(void (*cbk)(void *data, ErrorCategory category,
 					 int pos, char *msg),
 			     void *data);
 
+extern void (*getErrorCallback())(void *data, ErrorCategory category,
+				  int pos, char *msg);
+
 extern void *getErrorCallbackData();
 
 extern void CDECL error(ErrorCategory category, GFileOffset pos,
@@ -715,8 +715,12 @@ void Gfx::go(GBool topLevel) {
   int numArgs, i;
   int errCount;
 
-  // scan a sequence of objects
-  opCounter = 0;
+  // scan a sequence of objects; the operation counter carries on
+  // through forms and patterns, so a deep nest of small content
+  // streams still gets checked for an abort
+  if (topLevel) {
+    opCounter = 0;
+  }
   aborted = gFalse;
   errCount = 0;
   numArgs = 0;
@@ -4100,7 +4104,7 @@ void Gfx::opXObject(Object args[], int numArgs) {
 #endif
     xObj.streamGetDict()->lookup("Subtype", &obj2);
     if (obj2.isName("Image")) {
-      if (out->needNonText()) {
+      if (out->needNonText() || out->needImageInfo()) {
 	doImage(&refObj, xObj.getStream(), gFalse);
       }
     } else if (obj2.isName("Form")) {
@@ -4933,10 +4937,11 @@ void Gfx::opBeginImage(Object args[], int numArgs) {
     if (!doImage(NULL, str, gTrue)) {
       delete str;
   
-    // if we have the stream length, skip to end-of-stream and then
-    // skip 'EI' in the original stream
+    // if we have the stream length, skip to end-of-stream (without
+    // decoding what the output device didn't read) and then skip 'EI'
+    // in the original stream
     } else if (haveLength) {
-      while ((c1 = str->getChar()) != EOF) ;
+      while ((c1 = str->getUndecodedStream()->getChar()) != EOF) ;
       delete str;
       str = parser->getStream();
       c1 = str->getChar();
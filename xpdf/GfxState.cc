@@ -3700,6 +3700,7 @@ GfxImageColorMap::GfxImageColorMap(int bitsA, Object *decode,
   colorSpace = colorSpaceA;
 
   // initialize
+  initByteLookup();
   for (k = 0; k < gfxColorMaxComps; ++k) {
     lookup[k] = NULL;
     lookup2[k] = NULL;
@@ -3828,6 +3829,7 @@ GfxImageColorMap::GfxImageColorMap(GfxImageColorMap *colorMap) {
   nComps = colorMap->nComps;
   nComps2 = colorMap->nComps2;
   colorSpace2 = NULL;
+  initByteLookup();
   for (k = 0; k < gfxColorMaxComps; ++k) {
     lookup[k] = NULL;
     lookup2[k] = NULL;
@@ -3869,6 +3871,67 @@ GfxImageColorMap::~GfxImageColorMap() {
     gfree(lookup[i]);
     gfree(lookup2[i]);
   }
+  gfree(byteLookup);
+  gfree(rgbByteLookup);
+}
+
+void GfxImageColorMap::initByteLookup() {
+  byteLookup = NULL;
+  byteLookupComps = 0;
+  byteLookupRI = gfxRenderingIntentRelativeColorimetric;
+  rgbByteLookup = NULL;
+  rgbByteIdentity = gFalse;
+}
+
+// The color of a one-component pixel depends only on its value, so a
+// whole line can be converted with one table lookup per pixel instead
+// of one (virtual) color space conversion.  The table is filled with
+// the same per-pixel conversion, so the results are identical.
+void GfxImageColorMap::buildByteLookup(int nOut, GfxRenderingIntent ri) {
+  GfxGray gray;
+  GfxRGB rgb;
+  Guchar x;
+  int n, i;
+
+  n = bits <= 8 ? (1 << bits) : 256;
+  if (!byteLookup) {
+    byteLookup = (Guchar *)gmallocn(256, 3);
+    memset(byteLookup, 0, 256 * 3);
+  }
+  for (i = 0; i < n; ++i) {
+    x = (Guchar)i;
+    if (nOut == 1) {
+      getGray(&x, &gray, ri);
+      byteLookup[i] = colToByte(gray);
+    } else {
+      getRGB(&x, &rgb, ri);
+      byteLookup[3*i] = colToByte(rgb.r);
+      byteLookup[3*i + 1] = colToByte(rgb.g);
+      byteLookup[3*i + 2] = colToByte(rgb.b);
+    }
+  }
+  byteLookupComps = nOut;
+  byteLookupRI = ri;
+}
+
+// DeviceRGB converts each component on its own (clip01), so 8-bit
+// values can be mapped per component -- and copied as they are with
+// the default decode array.
+void GfxImageColorMap::buildRGBByteLookup() {
+  int n, i, k;
+
+  n = bits <= 8 ? (1 << bits) : 256;
+  rgbByteLookup = (Guchar *)gmallocn(3, 256);
+  memset(rgbByteLookup, 0, 3 * 256);
+  rgbByteIdentity = n == 256;
+  for (k = 0; k < 3; ++k) {
+    for (i = 0; i < n; ++i) {
+      rgbByteLookup[k * 256 + i] = colToByte(clip01(lookup[k][i]));
+      if (rgbByteLookup[k * 256 + i] != i) {
+	rgbByteIdentity = gFalse;
+      }
+    }
+  }
 }
 
 void GfxImageColorMap::getGray(Guchar *x, GfxGray *gray,
@@ -3939,7 +4002,14 @@ void GfxImageColorMap::getGrayByteLine(Guchar *in, Guchar *out, int n,
   GfxGray gray;
   int i, j;
 
-  if (colorSpace2) {
+  if (nComps == 1) {
+    if (byteLookupComps != 1 || byteLookupRI != ri) {
+      buildByteLookup(1, ri);
+    }
+    for (j = 0; j < n; ++j) {
+      out[j] = byteLookup[in[j]];
+    }
+  } else if (colorSpace2) {
     for (j = 0; j < n; ++j) {
       for (i = 0; i < nComps2; ++i) {
 	color.c[i] = lookup2[i][in[j]];
@@ -3962,9 +4032,33 @@ void GfxImageColorMap::getRGBByteLine(Guchar *in, Guchar *out, int n,
 				      GfxRenderingIntent ri) {
   GfxColor color;
   GfxRGB rgb;
+  Guchar *p;
   int i, j;
 
-  if (colorSpace2) {
+  if (nComps == 1) {
+    if (byteLookupComps != 3 || byteLookupRI != ri) {
+      buildByteLookup(3, ri);
+    }
+    for (j = 0; j < n; ++j) {
+      p = &byteLookup[3 * in[j]];
+      out[j*3] = p[0];
+      out[j*3 + 1] = p[1];
+      out[j*3 + 2] = p[2];
+    }
+  } else if (colorSpace->getMode() == csDeviceRGB) {
+    if (!rgbByteLookup) {
+      buildRGBByteLookup();
+    }
+    if (rgbByteIdentity) {
+      memcpy(out, in, 3 * n);
+    } else {
+      for (j = 0; j < 3 * n; j += 3) {
+	out[j] = rgbByteLookup[in[j]];
+	out[j + 1] = rgbByteLookup[256 + in[j + 1]];
+	out[j + 2] = rgbByteLookup[512 + in[j + 2]];
+      }
+    }
+  } else if (colorSpace2) {
     for (j = 0; j < n; ++j) {
       for (i = 0; i < nComps2; ++i) {
 	color.c[i] = lookup2[i][in[j]];
@@ -980,6 +980,9 @@ public:
 private:
 
   GfxImageColorMap(GfxImageColorMap *colorMap);
+  void initByteLookup();
+  void buildByteLookup(int nOut, GfxRenderingIntent ri);
+  void buildRGBByteLookup();
 
   GfxColorSpace *colorSpace;	// the image color space
   int bits;			// bits per component
@@ -994,6 +997,14 @@ private:
     decodeLow[gfxColorMaxComps];
   double			// max - min value for each component
     decodeRange[gfxColorMaxComps];
+  Guchar *byteLookup;		// 8-bit gray or RGB color of each pixel
+				//   value, for one-component images
+				//   (built on first use)
+  int byteLookupComps;		// 1 (gray) or 3 (RGB) bytes per entry
+  GfxRenderingIntent byteLookupRI;	// intent byteLookup was built for
+  Guchar *rgbByteLookup;	// 8-bit value of each component value,
+				//   for DeviceRGB images (3 x 256)
+  GBool rgbByteIdentity;	// rgbByteLookup is the identity
   GBool ok;
 };
 
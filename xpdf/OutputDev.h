@@ -70,6 +70,11 @@ public:
   // Does this device need non-text content?
   virtual GBool needNonText() { return gTrue; }
 
+  // If needNonText() is false: does this device still want the
+  // drawImage/drawImageMask calls, for the size and position of the
+  // images?  The image data does not have to be read.
+  virtual GBool needImageInfo() { return gFalse; }
+
   // Does this device require incCharCount to be called for text on
   // non-shown layers?
   virtual GBool needCharCount() { return gFalse; }